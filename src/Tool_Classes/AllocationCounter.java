@@ -0,0 +1,27 @@
+package tool;
+
+
+import java.lang.management.ManagementFactory;
+import java.lang.management.ThreadMXBean;
+
+/**
+ * Reads how many bytes the current thread has allocated so far.
+ * Take the value before and after a piece of work and subtract.
+ * Returns -1 on JVMs that do not support per-thread allocation counting.
+ */
+public final class AllocationCounter {
+
+    private static final ThreadMXBean THREADS = ManagementFactory.getThreadMXBean();
+    private static final boolean SUPPORTED = THREADS instanceof com.sun.management.ThreadMXBean
+            && ((com.sun.management.ThreadMXBean) THREADS).isThreadAllocatedMemorySupported();
+
+    private AllocationCounter() {
+    }
+
+    public static long currentThreadAllocatedBytes() {
+        if (!SUPPORTED) {
+            return -1;
+        }
+        return ((com.sun.management.ThreadMXBean) THREADS).getCurrentThreadAllocatedBytes();
+    }
+}
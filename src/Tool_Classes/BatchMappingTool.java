@@ -0,0 +1,254 @@
+package tool;
+
+import java.io.IOException;
+import java.io.UncheckedIOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Semaphore;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
+
+/**
+ * BATCH MODE:
+ * Maps many old/new file pairs in one JVM, so JVM startup and JIT warmup are paid once.
+ *
+ * Input, either:
+ *  - two directory roots: every file under oldRoot that also exists (same relative path)
+ *    under newRoot is one pair, the mapping goes to outRoot/<relative path>.map.txt
+ *    (.map.xml, .map.jsonl, .map.bin with --format=xml|jsonl|binary)
+ *  - a manifest: one pair per line, tab separated:
+ *        oldPath<TAB>newPath<TAB>outputPath
+ *    relative paths are resolved against the manifest's folder, '#' lines are comments
+ *
+ * Each pair runs Preprocessor -> LineMappingTool.map -> MappingWriter. Loading/writing
+ * runs on an I/O pool and mapping on a CPU pool, so one pair can be read while another
+ * is being mapped. At most 2 x jobs pairs are in flight at once.
+ * --threads is the budget of the whole batch: with --hunks or --parallel-scoring every
+ * running pair gets threads / jobs of it (at least 1), so jobs pairs never start
+ * jobs x threads worker threads between them.
+ * --stats and --report are per run, so batch mode rejects them (map a single pair with
+ * LineMappingTool to measure it).
+ * At the end we print pairs/second and lines/second.
+ */
+public class BatchMappingTool {
+
+    private static final String USAGE = String.join("\n",
+            "Usage: java tool.BatchMappingTool [--jobs=N] [options] --dirs <oldRoot> <newRoot> <outRoot>",
+            "       java tool.BatchMappingTool [--jobs=N] [options] --manifest <pairs.tsv>",
+            "  --jobs=N   pairs mapped at the same time (default: number of cores);",
+            "             each pair gets --threads / N threads for --hunks / --parallel-scoring");
+
+    /**
+     * One old/new pair and where its mapping goes.
+     */
+    static final class Pair {
+        final Path oldPath;
+        final Path newPath;
+        final Path outPath;
+
+        Pair(Path oldPath, Path newPath, Path outPath) {
+            this.oldPath = oldPath;
+            this.newPath = newPath;
+            this.outPath = outPath;
+        }
+    }
+
+    // both versions of a pair after Step 1
+    private static final class Loaded {
+        final Pair pair;
+        final FileVersion oldFile;
+        final FileVersion newFile;
+
+        Loaded(Pair pair, FileVersion oldFile, FileVersion newFile) {
+            this.pair = pair;
+            this.oldFile = oldFile;
+            this.newFile = newFile;
+        }
+    }
+
+    private final MappingOptions options;
+    private final int jobs;
+
+    private final AtomicInteger pairsDone = new AtomicInteger();
+    private final AtomicInteger pairsFailed = new AtomicInteger();
+    private final AtomicLong linesDone = new AtomicLong(); // old + new lines of finished pairs
+
+    /**
+     * @param options mapping options of every pair (not changed: the pairs run on a copy
+     *                whose --threads is threads / jobs, at least 1)
+     * @param jobs    pairs mapped at the same time, at least 1
+     */
+    public BatchMappingTool(MappingOptions options, int jobs) {
+        if (jobs < 1) {
+            throw new IllegalArgumentException("jobs must be at least 1: " + jobs);
+        }
+        this.options = options.copy().setThreads(Math.max(1, options.getThreads() / jobs));
+        this.jobs = jobs;
+    }
+
+    public static void main(String[] args) throws IOException, InterruptedException {
+        MappingOptions options = new MappingOptions();
+        int jobs = Runtime.getRuntime().availableProcessors();
+        String mode = null;
+        List<String> paths = new ArrayList<>();
+
+        for (String arg : args) {
+            if (arg.equals("--dirs") || arg.equals("--manifest")) {
+                mode = arg;
+            } else if (arg.startsWith("--jobs=")) {
+                try {
+                    jobs = MappingOptions.parsePositive(arg.substring("--jobs=".length()));
+                } catch (IllegalArgumentException ex) {
+                    System.err.println("Unknown option or bad value: " + arg);
+                    System.err.println(USAGE);
+                    System.exit(1);
+                }
+            } else if (arg.startsWith("--")) {
+                if (!options.applyFlag(arg)) {
+                    System.err.println("Unknown option or bad value: " + arg);
+                    System.err.println(USAGE);
+                    System.err.println(MappingOptions.USAGE);
+                    System.exit(1);
+                }
+            } else {
+                paths.add(arg);
+            }
+        }
+
+        if (options.isPrintStats() || options.getReportFile() != null) {
+            System.err.println("--stats and --report measure one run; use LineMappingTool for a single pair");
+            System.err.println(USAGE);
+            System.exit(1);
+        }
+
+        List<Pair> pairs;
+        if ("--dirs".equals(mode) && paths.size() == 3) {
+            pairs = pairsFromDirectories(Path.of(paths.get(0)), Path.of(paths.get(1)), Path.of(paths.get(2)),
+                    options.getOutputFormat());
+        } else if ("--manifest".equals(mode) && paths.size() == 1) {
+            pairs = pairsFromManifest(Path.of(paths.get(0)));
+        } else {
+            System.err.println(USAGE);
+            System.err.println(MappingOptions.USAGE);
+            System.exit(1);
+            return;
+        }
+
+        new BatchMappingTool(options, jobs).runAll(pairs);
+    }
+
+    /**
+     * Map every pair, then print throughput. Pairs that fail are reported and skipped.
+     */
+    public void runAll(List<Pair> pairs) throws InterruptedException {
+        ExecutorService ioPool = Executors.newFixedThreadPool(Math.max(1, jobs / 2));
+        ExecutorService cpuPool = Executors.newFixedThreadPool(jobs);
+        Semaphore inFlight = new Semaphore(2 * jobs); // bounds memory: loaded pairs waiting for a CPU
+        List<CompletableFuture<Void>> futures = new ArrayList<>();
+
+        long start = System.nanoTime();
+        try {
+            for (Pair pair : pairs) {
+                inFlight.acquire();
+                CompletableFuture<Void> future = CompletableFuture
+                        .supplyAsync(() -> load(pair), ioPool)
+                        .thenApplyAsync(this::mapAndWrite, cpuPool)
+                        .handle((lines, ex) -> {
+                            inFlight.release();
+                            if (ex != null) {
+                                pairsFailed.incrementAndGet();
+                                Throwable cause = ex.getCause() != null ? ex.getCause() : ex;
+                                System.err.println("FAILED " + pair.oldPath + " -> " + pair.newPath + ": " + cause);
+                            } else {
+                                pairsDone.incrementAndGet();
+                                linesDone.addAndGet(lines);
+                            }
+                            return null;
+                        });
+                futures.add(future);
+            }
+            CompletableFuture.allOf(futures.toArray(new CompletableFuture[0])).join();
+        } finally {
+            ioPool.shutdown();
+            cpuPool.shutdown();
+        }
+        double seconds = (System.nanoTime() - start) / 1e9;
+
+        System.out.printf("Pairs mapped: %d (failed: %d) in %.2f s%n", pairsDone.get(), pairsFailed.get(), seconds);
+        System.out.printf("Throughput: %.1f pairs/s, %.0f lines/s%n",
+                pairsDone.get() / seconds, linesDone.get() / seconds);
+    }
+
+    // ----- helpers -----
+
+    private Loaded load(Pair pair) {
+        try {
+            // one Preprocessor per pair: its dictionary is shared by exactly these two files
+            Preprocessor preprocessor = LineMappingTool.newPreprocessor(options);
+            FileVersion oldFile = preprocessor.loadFile(pair.oldPath.toString());
+            FileVersion newFile = preprocessor.loadFile(pair.newPath.toString());
+            return new Loaded(pair, oldFile, newFile);
+        } catch (IOException ex) {
+            throw new UncheckedIOException(ex);
+        }
+    }
+
+    // returns the number of lines handled, for the throughput numbers
+    private long mapAndWrite(Loaded loaded) {
+        // LineMappingTool keeps per-run counters, so each pair gets its own
+        List<MappingEntry> mapping = new LineMappingTool().map(loaded.oldFile, loaded.newFile, options);
+        try {
+            Path parent = loaded.pair.outPath.toAbsolutePath().getParent();
+            if (parent != null) {
+                Files.createDirectories(parent);
+            }
+            new MappingWriter(MappingFormat.of(options.getOutputFormat())).writeMapping(loaded.pair.outPath.toString(), mapping);
+        } catch (IOException ex) {
+            throw new UncheckedIOException(ex);
+        }
+        return loaded.oldFile.getLines().size() + loaded.newFile.getLines().size();
+    }
+
+    static List<Pair> pairsFromDirectories(Path oldRoot, Path newRoot, Path outRoot,
+                                           MappingFormat.Kind format) throws IOException {
+        List<Path> oldFiles;
+        try (Stream<Path> walk = Files.walk(oldRoot)) {
+            oldFiles = walk.filter(Files::isRegularFile).sorted().collect(Collectors.toList());
+        }
+
+        List<Pair> pairs = new ArrayList<>();
+        for (Path oldFile : oldFiles) {
+            Path relative = oldRoot.relativize(oldFile);
+            Path newFile = newRoot.resolve(relative.toString());
+            if (Files.isRegularFile(newFile)) { // only files present in both trees
+                pairs.add(new Pair(oldFile, newFile, outRoot.resolve(relative.toString() + ".map" + format.extension)));
+            }
+        }
+        return pairs;
+    }
+
+    static List<Pair> pairsFromManifest(Path manifest) throws IOException {
+        Path base = manifest.toAbsolutePath().getParent();
+        List<Pair> pairs = new ArrayList<>();
+        for (String line : Files.readAllLines(manifest)) {
+            if (line.isBlank() || line.startsWith("#")) {
+                continue;
+            }
+            String[] parts = line.split("\t");
+            if (parts.length < 3) {
+                System.err.println("Skipping manifest line (need old<TAB>new<TAB>out): " + line);
+                continue;
+            }
+            pairs.add(new Pair(base.resolve(parts[0].trim()), base.resolve(parts[1].trim()),
+                    base.resolve(parts[2].trim())));
+        }
+        return pairs;
+    }
+}
@@ -0,0 +1,233 @@
+package tool;
+
+
+import java.io.BufferedOutputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.nio.file.Files;
+import java.nio.file.Path;
+
+/**
+ * Compact binary mapping for tools that read mappings back a lot (no text parsing):
+ *
+ *   header   magic "LMMB", format version, old line count, block size        (4 ints)
+ *   data     one varint per old line, in old line order:
+ *              mapped:  zigzag(new - previous mapped new) << 3 | split << 2 | status (0-2)
+ *                       followed by varint(newEnd - new) when split is set
+ *              deleted: 3, absent: 7
+ *            so a run of unchanged lines costs one byte per line
+ *   index    per block of BLOCK_SIZE old lines: data offset (long) + previous mapped new (int)
+ *   footer   index offset (long)
+ *
+ * The Reader memory-maps the file and answers "new line of old line X" by jumping to the
+ * block through the index and decoding at most BLOCK_SIZE varints, so O(1) per lookup.
+ * Scores are not stored, use JSON Lines for those.
+ */
+public class BinaryMappingFormat implements MappingFormat {
+
+    private static final int MAGIC = 0x4C4D4D42; // "LMMB"
+    private static final int FORMAT_VERSION = 2; // 2: split groups
+    static final int BLOCK_SIZE = 64;
+    private static final int HEADER_BYTES = 16;
+
+    private static final int CODE_DELETED = 3;
+    private static final int CODE_ABSENT = 7;
+    private static final int SPLIT_FLAG = 4;
+
+    @Override
+    public void write(MappingTable table, Path out) throws IOException {
+        int n = table.size();
+        int blocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        long[] blockOffsets = new long[blocks];
+        int[] blockPrevious = new int[blocks];
+
+        try (DataOutputStream data = new DataOutputStream(new BufferedOutputStream(Files.newOutputStream(out), 1 << 16))) {
+            data.writeInt(MAGIC);
+            data.writeInt(FORMAT_VERSION);
+            data.writeInt(n);
+            data.writeInt(BLOCK_SIZE);
+
+            long offset = HEADER_BYTES;
+            int previous = 0;
+            for (int oldLine = 1; oldLine <= n; oldLine++) {
+                if ((oldLine - 1) % BLOCK_SIZE == 0) {
+                    blockOffsets[(oldLine - 1) / BLOCK_SIZE] = offset;
+                    blockPrevious[(oldLine - 1) / BLOCK_SIZE] = previous;
+                }
+                long code;
+                int span = 0; // extra new lines of a split group
+                if (!table.has(oldLine)) {
+                    code = CODE_ABSENT;
+                } else if (table.getNewLine(oldLine) == -1) {
+                    code = CODE_DELETED;
+                } else {
+                    int newLine = table.getNewLine(oldLine);
+                    span = table.getNewLineEnd(oldLine) - newLine;
+                    code = zigzag(newLine - previous) << 3 | (span > 0 ? SPLIT_FLAG : 0) | table.getStatusCode(oldLine);
+                    previous = newLine;
+                }
+                offset += writeVarint(data, code);
+                if (span > 0) {
+                    offset += writeVarint(data, span);
+                }
+            }
+
+            long indexOffset = offset;
+            for (int b = 0; b < blocks; b++) {
+                data.writeLong(blockOffsets[b]);
+                data.writeInt(blockPrevious[b]);
+            }
+            data.writeLong(indexOffset);
+        }
+    }
+
+    /**
+     * Random access to a written binary mapping.
+     */
+    public static final class Reader {
+        private final ByteBuffer bytes; // read with absolute gets only
+        private final int size;
+        private final int blockSize;
+        private final int indexOffset;
+
+        private Reader(ByteBuffer bytes) throws IOException {
+            if (bytes.limit() < HEADER_BYTES + 8 || bytes.getInt(0) != MAGIC || bytes.getInt(4) != FORMAT_VERSION) {
+                throw new IOException("Not a binary mapping file");
+            }
+            this.bytes = bytes;
+            this.size = bytes.getInt(8);
+            this.blockSize = bytes.getInt(12);
+            this.indexOffset = (int) bytes.getLong(bytes.limit() - 8);
+        }
+
+        public static Reader open(Path file) throws IOException {
+            return new Reader(MappedLines.mapFile(file));
+        }
+
+        /**
+         * Number of old lines.
+         */
+        public int size() {
+            return size;
+        }
+
+        /**
+         * New line of oldLine, or -1 if it was deleted (or is not in the mapping).
+         */
+        public int getNewLine(int oldLine) {
+            long line = decode(oldLine);
+            return isMapped(line) ? (int) (line >>> 32) : -1;
+        }
+
+        /**
+         * Last new line of oldLine's split group (= getNewLine when it was not split).
+         */
+        public int getNewLineEnd(int oldLine) {
+            long line = decode(oldLine);
+            return isMapped(line) ? (int) (line >>> 32) + (int) (line >>> 3 & 0x1FFFFFFF) : -1;
+        }
+
+        /**
+         * MappingTable status code of oldLine (MappingTable.UNCHANGED etc.).
+         */
+        public byte getStatusCode(int oldLine) {
+            long line = decode(oldLine);
+            if (line == CODE_ABSENT) return MappingTable.ABSENT;
+            return (byte) (line & 3);
+        }
+
+        /**
+         * The whole file as a table (scores unknown).
+         */
+        public MappingTable toTable() {
+            int[] newLines = new int[size];
+            int[] newLineEnds = new int[size];
+            byte[] statuses = new byte[size];
+            float[] scores = new float[size];
+            ByteBuffer in = bytes.duplicate(); // own position, so readers don't race
+            in.position(HEADER_BYTES);
+            int previous = 0;
+            for (int i = 0; i < size; i++) {
+                long code = readVarint(in);
+                if (code == CODE_ABSENT || code == CODE_DELETED) {
+                    newLines[i] = -1;
+                    newLineEnds[i] = -1;
+                    statuses[i] = code == CODE_ABSENT ? MappingTable.ABSENT : MappingTable.DELETED;
+                } else {
+                    previous += unzigzag(code >>> 3);
+                    newLines[i] = previous;
+                    newLineEnds[i] = (code & SPLIT_FLAG) != 0 ? previous + (int) readVarint(in) : previous;
+                    statuses[i] = (byte) (code & 3);
+                }
+                scores[i] = Float.NaN;
+            }
+            return new MappingTable(newLines, newLineEnds, statuses, scores);
+        }
+
+        // deleted/absent come back as their code; a mapped line as
+        // new line << 32 | (newEnd - new) << 3 | status
+        private long decode(int oldLine) {
+            if (oldLine < 1 || oldLine > size) {
+                return CODE_ABSENT;
+            }
+            int block = (oldLine - 1) / blockSize;
+            int entry = indexOffset + block * 12;
+            ByteBuffer in = bytes.duplicate();
+            in.position((int) bytes.getLong(entry));
+            int previous = bytes.getInt(entry + 8);
+            int skip = (oldLine - 1) % blockSize;
+            for (int i = 0; ; i++) {
+                long code = readVarint(in);
+                if (code == CODE_ABSENT || code == CODE_DELETED) {
+                    if (i == skip) return code;
+                    continue;
+                }
+                previous += unzigzag(code >>> 3);
+                long span = (code & SPLIT_FLAG) != 0 ? readVarint(in) : 0;
+                if (i == skip) {
+                    return ((long) previous << 32) | span << 3 | (code & 3);
+                }
+            }
+        }
+
+        private static boolean isMapped(long line) {
+            return line != CODE_ABSENT && line != CODE_DELETED;
+        }
+    }
+
+    // ----- helpers -----
+
+    private static long zigzag(int value) {
+        return ((long) value << 1) ^ ((long) value >> 63);
+    }
+
+    private static int unzigzag(long value) {
+        return (int) ((value >>> 1) ^ -(value & 1));
+    }
+
+    private static long readVarint(ByteBuffer in) {
+        long value = 0;
+        int shift = 0;
+        byte b;
+        do {
+            b = in.get();
+            value |= (long) (b & 0x7F) << shift;
+            shift += 7;
+        } while (b < 0);
+        return value;
+    }
+
+    // returns the number of bytes written
+    private static int writeVarint(OutputStream out, long value) throws IOException {
+        int written = 1;
+        while ((value & ~0x7FL) != 0) {
+            out.write((int) ((value & 0x7F) | 0x80));
+            value >>>= 7;
+            written++;
+        }
+        out.write((int) value);
+        return written;
+    }
+}
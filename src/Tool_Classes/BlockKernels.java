@@ -0,0 +1,73 @@
+package tool;
+
+
+/**
+ * Step 4 block kernels: one old line against a block of candidate new lines
+ * (SimHash Hamming distance, bitset Jaccard). SimHash.similarityBlock and
+ * JaccardKernel.jaccardBlock go through ACTIVE.
+ *
+ * Two implementations, picked once at startup:
+ *  - VectorKernels (src/Tool_Vector): jdk.incubator.vector, XOR/AND + lane popcount
+ *    over as many longs as the CPU's vectors hold (4 on AVX2, 8 on AVX-512)
+ *  - SCALAR: the plain Long.bitCount loops (SimHash.similarityBlockScalar,
+ *    JaccardKernel.jaccardBlockScalar), same numbers bit for bit
+ *
+ * The vector class lives in its own source folder because it only compiles with the
+ * incubator module, and the rest of the tool must keep compiling without it:
+ *   javac -d out src/Tool_Classes/*.java
+ *   javac --add-modules jdk.incubator.vector -cp out -d out src/Tool_Vector/*.java   (JDK 21+, optional)
+ *   java --add-modules jdk.incubator.vector -cp out tool.LineMappingTool ...
+ * Without the module at run time (or without the compiled class, or with
+ * -Dtool.vector=false) ACTIVE is SCALAR.
+ */
+interface BlockKernels {
+
+    /**
+     * SimHash.similarity(query, fingerprints[lines[k] - 1]) for k < count, into out[k].
+     */
+    void similarityBlock(long query, long[] fingerprints, int[] lines, int count, double[] out);
+
+    /**
+     * JaccardKernel.jaccard(a, rows[lines[k] - 1]) for k < count, into out[k].
+     */
+    void jaccardBlock(long[] a, long[][] rows, int[] lines, int count, double[] out);
+
+    /**
+     * For benchmark output, e.g. "scalar" or "vector (256-bit)".
+     */
+    String name();
+
+    BlockKernels SCALAR = new BlockKernels() {
+        @Override
+        public void similarityBlock(long query, long[] fingerprints, int[] lines, int count, double[] out) {
+            SimHash.similarityBlockScalar(query, fingerprints, lines, count, out);
+        }
+
+        @Override
+        public void jaccardBlock(long[] a, long[][] rows, int[] lines, int count, double[] out) {
+            JaccardKernel.jaccardBlockScalar(a, rows, lines, count, out);
+        }
+
+        @Override
+        public String name() {
+            return "scalar";
+        }
+    };
+
+    BlockKernels ACTIVE = select();
+
+    // VectorKernels if the incubator module is there and the class was compiled, else SCALAR
+    private static BlockKernels select() {
+        if ("false".equals(System.getProperty("tool.vector"))) {
+            return SCALAR;
+        }
+        if (ModuleLayer.boot().findModule("jdk.incubator.vector").isEmpty()) {
+            return SCALAR; // started without --add-modules jdk.incubator.vector
+        }
+        try {
+            return (BlockKernels) Class.forName("tool.VectorKernels").getDeclaredConstructor().newInstance();
+        } catch (ReflectiveOperationException | LinkageError ex) {
+            return SCALAR; // not compiled (src/Tool_Vector left out) or no usable vector shape
+        }
+    }
+}
@@ -3,7 +3,6 @@ package tool;
 
 
 import java.util.*;
-import java.util.stream.Collectors;
 
 /**
  * Step 3: GENERATE CANDIDATES FOR CHANGED LINES
@@ -13,7 +12,7 @@ import java.util.stream.Collectors;
  *   - within a fixed window around the same line number, and
  *   - optionally filtered by token overlap on normalized text.
  */
-public class CandidateGenerator { // this is for candidate generation
+public class CandidateGenerator implements CandidateSource { // this is for candidate generation
 
     private final int windowSize;              // e.g., 10 lines above/below
     private final boolean requireTokenOverlap; // true = filter by token overlap
@@ -27,6 +26,7 @@ public class CandidateGenerator { // this is for candidate generation
      * Generate candidate lists:
      *   oldLineNumber -> list of new line numbers that are candidates.
      */
+    @Override
     public Map<Integer, List<Integer>> generateCandidates( // we generate candidates to map lines
             FileVersion oldFile,
             FileVersion newFile,
@@ -71,19 +71,15 @@ public class CandidateGenerator { // this is for candidate generation
     }
 
     private boolean hasTokenOverlap(LineRecord oldLine, LineRecord newLine) { // to check token overlap
-        Set<String> oldTokens = tokenize(oldLine.getNormalizedText());
-        Set<String> newTokens = tokenize(newLine.getNormalizedText());
-
-        oldTokens.retainAll(newTokens);
-        return !oldTokens.isEmpty();
-    }
-
-    private Set<String> tokenize(String text) {
-        if (text == null || text.isBlank()) {
-            return Collections.emptySet();
+        int[] a = oldLine.getTokenIds(); // both sorted, so we can walk them together
+        int[] b = newLine.getTokenIds();
+        int i = 0;
+        int j = 0;
+        while (i < a.length && j < b.length) {
+            if (a[i] == b[j]) return true;
+            if (a[i] < b[j]) i++;
+            else j++;
         }
-        return Arrays.stream(text.split("\\W+"))
-                .filter(s -> !s.isBlank())
-                .collect(Collectors.toSet());
+        return false;
     }
 }
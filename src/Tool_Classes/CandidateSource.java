@@ -0,0 +1,25 @@
+package tool;
+
+
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+
+/**
+ * Step 3: anything that can produce candidate new lines for the unmatched old lines.
+ *
+ *  - CandidateGenerator               fixed window around the same line number
+ *  - InvertedIndexCandidateGenerator  shared tokens anywhere in the file
+ *  - MinHashCandidateGenerator        MinHash signatures + banded LSH, for very large files
+ */
+public interface CandidateSource {
+
+    /**
+     * Generate candidate lists:
+     *   oldLineNumber -> list of new line numbers that are candidates.
+     */
+    Map<Integer, List<Integer>> generateCandidates(FileVersion oldFile,
+                                                   FileVersion newFile,
+                                                   Set<Integer> unmatchedOldLines,
+                                                   Set<Integer> unmatchedNewLines);
+}
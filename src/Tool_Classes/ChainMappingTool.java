@@ -0,0 +1,210 @@
+package tool;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+
+/**
+ * CHAIN MODE:
+ * Tracks lines across an ordered list of versions v1, v2, ..., vN of one file.
+ *
+ *  - every version is preprocessed exactly once, all by the same Preprocessor, so token ids
+ *    line up across the whole chain (and the middle versions' token rows / context sets are
+ *    built once and reused by both pairs they are part of)
+ *  - the adjacent pairs v1->v2, v2->v3, ... are mapped, optionally in parallel
+ *  - the pair mappings are composed into one v1->vN mapping:
+ *        v1 line -> v2 line -> ... -> vN line, and once a step gives -1 the line stays deleted
+ *    a split (v1 line -> a run of new lines) is carried along as long as every later step
+ *    maps the run onto a run again, so 1:N mappings survive the chain
+ *
+ * The output is the usual "ORIG NEW" file, ORIG from v1 and NEW from vN.
+ */
+public class ChainMappingTool {
+
+    private static final String USAGE = String.join("\n",
+            "Usage: java tool.ChainMappingTool [--parallel] [--pairs-out=<dir>] [options] <v1> <v2> ... <vN> <outputMappingFile>",
+            "  --parallel         map the adjacent pairs at the same time (on --threads threads)",
+            "  --pairs-out=<dir>  also write each adjacent mapping as <dir>/step<k>.map.txt",
+            "                     (.map.xml, .map.jsonl, .map.bin with --format=xml|jsonl|binary)");
+
+    private final MappingOptions options;
+    private final boolean parallel;
+
+    public ChainMappingTool(MappingOptions options, boolean parallel) {
+        this.options = options;
+        this.parallel = parallel;
+    }
+
+    public static void main(String[] args) throws IOException {
+        MappingOptions options = new MappingOptions();
+        boolean parallel = false;
+        String pairsOut = null;
+        List<String> files = new ArrayList<>();
+
+        for (String arg : args) {
+            if (arg.equals("--parallel")) {
+                parallel = true;
+            } else if (arg.startsWith("--pairs-out=")) {
+                pairsOut = arg.substring("--pairs-out=".length());
+            } else if (arg.startsWith("--")) {
+                if (!options.applyFlag(arg)) {
+                    System.err.println("Unknown option or bad value: " + arg);
+                    System.err.println(USAGE);
+                    System.err.println(MappingOptions.USAGE);
+                    System.exit(1);
+                }
+            } else {
+                files.add(arg);
+            }
+        }
+
+        if (files.size() < 3) { // at least two versions + the output
+            System.err.println(USAGE);
+            System.err.println(MappingOptions.USAGE);
+            System.exit(1);
+        }
+
+        List<String> versions = files.subList(0, files.size() - 1);
+        String outFile = files.get(files.size() - 1);
+
+        ChainMappingTool tool = new ChainMappingTool(options, parallel);
+        List<FileVersion> loaded = tool.load(versions);
+        List<List<MappingEntry>> steps = tool.mapAdjacent(loaded);
+
+        MappingWriter writer = new MappingWriter(MappingFormat.of(options.getOutputFormat()));
+        if (pairsOut != null) {
+            Files.createDirectories(Path.of(pairsOut));
+            for (int k = 0; k < steps.size(); k++) {
+                writer.writeMapping(Path.of(pairsOut, "step" + (k + 1) + ".map" + options.getOutputFormat().extension).toString(), steps.get(k));
+            }
+        }
+        writer.writeMapping(outFile, compose(steps));
+    }
+
+    /**
+     * Step 1 for every version, once each, through one shared Preprocessor.
+     */
+    public List<FileVersion> load(List<String> versionPaths) throws IOException {
+        Preprocessor preprocessor = LineMappingTool.newPreprocessor(options);
+        List<FileVersion> versions = new ArrayList<>(versionPaths.size());
+        for (String path : versionPaths) {
+            versions.add(preprocessor.loadFile(path));
+        }
+        return versions;
+    }
+
+    /**
+     * Map every adjacent pair; result k is the mapping versions[k] -> versions[k + 1].
+     */
+    public List<List<MappingEntry>> mapAdjacent(List<FileVersion> versions) {
+        int pairs = versions.size() - 1;
+        List<List<MappingEntry>> steps = new ArrayList<>(pairs);
+
+        if (!parallel || pairs < 2 || options.getThreads() < 2) {
+            for (int k = 0; k < pairs; k++) {
+                steps.add(new LineMappingTool().map(versions.get(k), versions.get(k + 1), options));
+            }
+            return steps;
+        }
+
+        // FileVersion caches are safe to build from several threads, so a middle version
+        // can be used by two pairs at once
+        ExecutorService pool = Executors.newFixedThreadPool(Math.min(pairs, options.getThreads()));
+        try {
+            List<Future<List<MappingEntry>>> futures = new ArrayList<>(pairs);
+            for (int k = 0; k < pairs; k++) {
+                FileVersion from = versions.get(k);
+                FileVersion to = versions.get(k + 1);
+                // LineMappingTool keeps per-run counters, so one per pair
+                futures.add(pool.submit(() -> new LineMappingTool().map(from, to, options)));
+            }
+            for (Future<List<MappingEntry>> future : futures) {
+                steps.add(future.get()); // in chain order
+            }
+        } catch (InterruptedException ex) {
+            Thread.currentThread().interrupt();
+            throw new RuntimeException(ex);
+        } catch (ExecutionException ex) {
+            throw new RuntimeException(ex.getCause());
+        } finally {
+            pool.shutdown();
+        }
+        return steps;
+    }
+
+    /**
+     * Compose the pair mappings into one mapping from the first to the last version.
+     * A line is "unchanged" only if every step kept it unchanged; -1 at any step
+     * makes it "deleted" for good.
+     *
+     * Split groups: the line follows its first new line as before, and the group end is
+     * the end of the run its lines land on in the next step. That only holds while the
+     * run stays a run: if some line of it is deleted or lands out of order, the composed
+     * entry falls back to the first line alone (no split).
+     *
+     * @return one MappingEntry per line of the first version
+     */
+    public static List<MappingEntry> compose(List<List<MappingEntry>> steps) {
+        List<MappingEntry> composed = new ArrayList<>();
+        if (steps.isEmpty()) {
+            return composed;
+        }
+
+        // later steps as lookups: old line -> entry
+        List<Map<Integer, MappingEntry>> lookups = new ArrayList<>(steps.size());
+        for (List<MappingEntry> step : steps) {
+            Map<Integer, MappingEntry> byOld = new HashMap<>(step.size() * 2);
+            for (MappingEntry entry : step) {
+                byOld.put(entry.oldLine, entry);
+            }
+            lookups.add(byOld);
+        }
+
+        for (MappingEntry first : steps.get(0)) {
+            int line = first.newLine;
+            int end = first.newLineEnd; // == line unless a split; -1 once the run is broken
+            boolean unchanged = "unchanged".equals(first.status);
+            for (int k = 1; k < lookups.size() && line != -1; k++) {
+                Map<Integer, MappingEntry> lookup = lookups.get(k);
+                MappingEntry next = lookup.get(line);
+                end = end == -1 ? -1 : runEnd(lookup, line, end);
+                line = next == null ? -1 : next.newLine;
+                unchanged &= next != null && "unchanged".equals(next.status);
+            }
+
+            String status;
+            if (line == -1) {
+                status = "deleted";
+            } else if (unchanged) {
+                status = "unchanged";
+            } else {
+                status = "modified";
+            }
+            if (line == -1 || end == -1) end = line;
+            composed.add(new MappingEntry(first.oldLine, line, end, status, Double.NaN));
+        }
+        return composed;
+    }
+
+    // where the lines from..to land in one step: the end of that run, if they land on
+    // one contiguous run in order (each line's group right after the previous one), else -1
+    private static int runEnd(Map<Integer, MappingEntry> lookup, int from, int to) {
+        int end = -1;
+        for (int line = from; line <= to; line++) {
+            MappingEntry entry = lookup.get(line);
+            if (entry == null || entry.newLine == -1 || (end != -1 && entry.newLine != end + 1)) {
+                return -1;
+            }
+            end = entry.newLineEnd;
+        }
+        return end;
+    }
+}
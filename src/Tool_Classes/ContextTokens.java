@@ -0,0 +1,123 @@
+package tool;
+
+
+import java.util.Arrays;
+
+/**
+ * The token set of every line's context window, built once per file.
+ *
+ * Context of line i = distinct tokens of lines [i - window, i + window] (clipped).
+ * Instead of re-collecting the window for every candidate pair, we slide it down
+ * the file once: keep a count per token, add the entering line's tokens, remove
+ * the leaving line's tokens, and snapshot the tokens whose count is above zero.
+ * That is O(lines x tokens per line) for the whole file.
+ */
+public class ContextTokens {
+
+    private final int[][] sets;      // sets[i] = sorted distinct token ids around line i+1
+    private final int tokenIdLimit;  // every id in sets is below this
+    private volatile long[][] bits;  // same sets as bitsets, built on first use
+
+    private ContextTokens(int[][] sets, int tokenIdLimit) {
+        this.sets = sets;
+        this.tokenIdLimit = tokenIdLimit;
+    }
+
+    /**
+     * @param rows   token ids per line (0-based), sorted and distinct
+     * @param window lines above/below
+     */
+    public static ContextTokens build(int[][] rows, int window) {
+        int n = rows.length;
+        int maxId = -1;
+        for (int[] row : rows) {
+            if (row.length > 0) maxId = Math.max(maxId, row[row.length - 1]);
+        }
+
+        RollingSet window1 = new RollingSet(maxId + 1);
+        for (int r = 0; r <= window && r < n; r++) {
+            window1.add(rows[r]); // initial window for line 1
+        }
+
+        int[][] sets = new int[n][];
+        for (int i = 0; i < n; i++) {
+            sets[i] = window1.snapshot();
+            int leaving = i - window;
+            int entering = i + window + 1;
+            if (leaving >= 0) window1.remove(rows[leaving]);
+            if (entering < n) window1.add(rows[entering]);
+        }
+        return new ContextTokens(sets, maxId + 1);
+    }
+
+    /**
+     * Context token ids around the line (1-based), ascending. Shared array, do not modify.
+     */
+    public int[] get(int lineNumber) {
+        return sets[lineNumber - 1];
+    }
+
+    /**
+     * One more than the largest token id in any set (0 for a file without tokens).
+     */
+    public int getTokenIdLimit() {
+        return tokenIdLimit;
+    }
+
+    /**
+     * Context sets as bitsets, indexed by lineNumber - 1.
+     * Only sensible when getTokenIdLimit() is small.
+     */
+    public long[][] getBits() {
+        long[][] b = bits;
+        if (b == null) {
+            b = new long[sets.length][];
+            for (int i = 0; i < b.length; i++) {
+                b[i] = JaccardKernel.toBits(sets[i]);
+            }
+            bits = b; // a racing thread builds the same thing, harmless
+        }
+        return b;
+    }
+
+    // ----- helpers -----
+
+    // token counts of the current window plus the list of tokens with count > 0
+    private static class RollingSet {
+        private final int[] counts;
+        private final int[] active;   // unordered ids with count > 0
+        private final int[] position; // position[id] = index of id in active
+        private int activeCount;
+
+        RollingSet(int idLimit) {
+            counts = new int[idLimit];
+            active = new int[idLimit];
+            position = new int[idLimit];
+        }
+
+        void add(int[] tokenIds) {
+            for (int id : tokenIds) {
+                if (counts[id]++ == 0) {
+                    position[id] = activeCount;
+                    active[activeCount++] = id;
+                }
+            }
+        }
+
+        void remove(int[] tokenIds) {
+            for (int id : tokenIds) {
+                if (--counts[id] == 0) {
+                    int last = active[--activeCount]; // swap the last one into the hole
+                    active[position[id]] = last;
+                    position[last] = position[id];
+                }
+            }
+        }
+
+        int[] snapshot() {
+            int[] set = Arrays.copyOf(active, activeCount);
+            Arrays.sort(set);
+            return set;
+        }
+    }
+}
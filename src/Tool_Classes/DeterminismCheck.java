@@ -0,0 +1,147 @@
+package tool;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+/**
+ * Check: parallel scoring (--parallel-scoring) must give exactly the mapping of the
+ * sequential Mapper, on every run.
+ *
+ * Every pair is loaded once, mapped sequentially, then mapped --runs times with
+ * --parallel-scoring --threads=N, and every MappingEntry (old, new, new end, status,
+ * score) is compared with the sequential list. The first difference of a pair is
+ * printed and the exit code is 1 if any pair differed.
+ *
+ * Pairs: the sample pairs under file_mapping/ (or --samples=<dir>) plus EditGenerator
+ * pairs of --synthetic=N,... old lines (default 1000,20000; big enough that the
+ * scoring is really split into chunks), grown from --seed-file.
+ *
+ *   java tool.DeterminismCheck [--samples=<dir>] [--synthetic=N,...] [--seed-file=<file>]
+ *        [--threads=N] [--runs=N] [options]
+ */
+public class DeterminismCheck {
+
+    private static final String USAGE =
+            "Usage: java tool.DeterminismCheck [--samples=<dir>] [--synthetic=N,...] [--seed-file=<file>]"
+                    + " [--threads=N] [--runs=N] [options]";
+
+    public static void main(String[] args) throws IOException {
+        List<String> flags = new ArrayList<>(); // mapping options, for both the sequential and parallel runs
+        Path samples = Path.of("file_mapping");
+        Path seedFile = null;
+        int[] syntheticSizes = {1_000, 20_000};
+        int threads = Math.max(2, Runtime.getRuntime().availableProcessors());
+        int runs = 5;
+
+        for (String arg : args) {
+            if (arg.startsWith("--samples=")) {
+                String value = arg.substring("--samples=".length());
+                samples = value.isEmpty() ? null : Path.of(value);
+            } else if (arg.startsWith("--synthetic=")) {
+                String value = arg.substring("--synthetic=".length());
+                syntheticSizes = value.isEmpty() ? new int[0]
+                        : Arrays.stream(value.split(",")).mapToInt(v -> Integer.parseInt(v.trim())).toArray();
+            } else if (arg.startsWith("--seed-file=")) {
+                seedFile = Path.of(arg.substring("--seed-file=".length()));
+            } else if (arg.startsWith("--threads=")) {
+                threads = Integer.parseInt(arg.substring("--threads=".length()));
+            } else if (arg.startsWith("--runs=")) {
+                runs = Integer.parseInt(arg.substring("--runs=".length()));
+            } else if (new MappingOptions().applyFlag(arg)) {
+                flags.add(arg);
+            } else {
+                System.err.println("Unknown option or bad value: " + arg);
+                System.err.println(USAGE);
+                System.err.println(MappingOptions.USAGE);
+                System.exit(1);
+            }
+        }
+
+        MappingOptions sequential = options(flags).setParallelScoring(false);
+        MappingOptions parallel = options(flags).setParallelScoring(true).setThreads(threads);
+
+        List<Path[]> pairs = new ArrayList<>();
+        List<SamplePairs.Pair> samplePairs = new ArrayList<>();
+        if (samples != null && Files.isDirectory(samples)) {
+            samplePairs = SamplePairs.find(samples);
+            for (SamplePairs.Pair pair : samplePairs) {
+                pairs.add(new Path[]{pair.oldPath, pair.newPath});
+            }
+        }
+
+        Path tempDir = Files.createTempDirectory("determinism");
+        int failed = 0;
+        try {
+            List<String> seedLines = seedFile != null ? EditGenerator.readSeed(seedFile)
+                    : PipelineBenchmark.defaultSeed(samplePairs);
+            for (int size : syntheticSizes) {
+                pairs.add(PipelineBenchmark.syntheticPair(tempDir, seedLines, size, 42L + size));
+            }
+
+            for (Path[] pair : pairs) {
+                Preprocessor preprocessor = LineMappingTool.newPreprocessor(sequential);
+                FileVersion oldFile = preprocessor.loadFile(pair[0].toString());
+                FileVersion newFile = preprocessor.loadFile(pair[1].toString());
+
+                List<MappingEntry> expected = new LineMappingTool().map(oldFile, newFile, sequential);
+                String difference = null;
+                for (int run = 0; run < runs && difference == null; run++) {
+                    difference = firstDifference(expected, new LineMappingTool().map(oldFile, newFile, parallel));
+                    if (difference != null) difference = "run " + (run + 1) + ": " + difference;
+                }
+
+                if (difference == null) {
+                    System.out.printf("ok    %s (%d lines, %d runs on %d threads)%n",
+                            pair[0], oldFile.getLines().size(), runs, threads);
+                } else {
+                    System.out.printf("DIFF  %s: %s%n", pair[0], difference);
+                    failed++;
+                }
+            }
+        } finally {
+            PipelineBenchmark.deleteTree(tempDir);
+        }
+
+        System.out.printf("%d of %d pairs differ between sequential and parallel scoring%n", failed, pairs.size());
+        if (failed > 0) {
+            System.exit(1);
+        }
+    }
+
+    /**
+     * Description of the first entry where the two mappings differ, or null if they are the same.
+     */
+    static String firstDifference(List<MappingEntry> expected, List<MappingEntry> actual) {
+        if (expected.size() != actual.size()) {
+            return expected.size() + " entries sequential, " + actual.size() + " parallel";
+        }
+        for (int i = 0; i < expected.size(); i++) {
+            MappingEntry a = expected.get(i);
+            MappingEntry b = actual.get(i);
+            if (a.oldLine != b.oldLine || a.newLine != b.newLine || a.newLineEnd != b.newLineEnd
+                    || !a.status.equals(b.status) || Double.compare(a.score, b.score) != 0) {
+                return "entry " + i + ": " + describe(a) + " sequential, " + describe(b) + " parallel";
+            }
+        }
+        return null;
+    }
+
+    // ----- helpers -----
+
+    private static MappingOptions options(List<String> flags) {
+        MappingOptions options = new MappingOptions();
+        for (String flag : flags) {
+            options.applyFlag(flag);
+        }
+        return options;
+    }
+
+    private static String describe(MappingEntry e) {
+        return e.oldLine + " -> " + e.newLine + (e.isSplit() ? ".." + e.newLineEnd : "")
+                + " " + e.status + " " + e.score;
+    }
+}
@@ -0,0 +1,292 @@
+package tool;
+
+
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * Step 2 (alternative): DETECT UNCHANGED LINES WITH A REAL DIFF
+ *
+ * UnchangedDetector matches lines greedily and ignores order, so a common line
+ * like "}" can anchor to a new line far away. This detector keeps the order:
+ *
+ * Logic:
+ *  - Use the Preprocessor's line ids (equal text -> equal id), so no line text is built;
+ *    an id the dictionary marks ambiguous (hash collision) is split up by its text.
+ *  - Trim the common prefix and common suffix (cheap, and usually most of the file).
+ *  - On what is left, use patience diff: lines that occur exactly once in both
+ *    ranges are matched by longest increasing subsequence and used as anchors.
+ *  - The gaps between those anchors are handled the same way (recursively); a gap
+ *    with no unique lines falls back to Myers' O(ND) diff.
+ *  - Store mapping as: oldLineNumber -> newLineNumber (same shape as UnchangedDetector)
+ *
+ * The result never crosses: if old a < old b then new(a) < new(b).
+ */
+public class DiffAnchorDetector {
+
+    // Myers keeps one V array per edit step, so we stop if a gap is this different
+    // and fall back to a simple in-order greedy match for that gap.
+    private static final int MAX_EDIT_DISTANCE = 2048;
+
+    private int[] oldIds;
+    private int[] newIds;
+    private Map<Integer, Integer> mapping;
+
+    private int matchedCount; // how many pairs the last run produced
+    private int prefixLength; // shared prefix length of the last run
+    private int suffixLength; // shared suffix length of the last run
+
+    /**
+     * Detect unchanged lines between two file versions, preserving line order.
+     *
+     * @param oldFile the original version
+     * @param newFile the new version
+     * @return a map oldLineNumber -> newLineNumber for unchanged lines
+     */
+    public Map<Integer, Integer> detectUnchanged(FileVersion oldFile, FileVersion newFile) {
+        mapping = new HashMap<>();
+        assignIds(oldFile.getLines(), newFile.getLines(), oldFile.getDictionary());
+
+        int n = oldIds.length;
+        int m = newIds.length;
+
+        // Common prefix / suffix fast path
+        int prefix = 0;
+        while (prefix < n && prefix < m && oldIds[prefix] == newIds[prefix]) {
+            match(prefix, prefix);
+            prefix++;
+        }
+        int suffix = 0;
+        while (suffix < n - prefix && suffix < m - prefix
+                && oldIds[n - 1 - suffix] == newIds[m - 1 - suffix]) {
+            match(n - 1 - suffix, m - 1 - suffix);
+            suffix++;
+        }
+        prefixLength = prefix;
+        suffixLength = suffix;
+
+        diffRange(prefix, n - suffix, prefix, m - suffix);
+
+        matchedCount = mapping.size();
+        Map<Integer, Integer> result = mapping;
+        oldIds = null; // drop the working arrays
+        newIds = null;
+        mapping = null;
+        return result;
+    }
+
+    public int getMatchedCount() {
+        return matchedCount;
+    }
+
+    public int getPrefixLength() {
+        return prefixLength;
+    }
+
+    public int getSuffixLength() {
+        return suffixLength;
+    }
+
+    // ----- helpers -----
+
+    // equal normalized text -> equal id, so the diff only compares ints
+    private void assignIds(List<LineRecord> oldLines, List<LineRecord> newLines, TokenDictionary dictionary) {
+        Map<String, Integer> split = new HashMap<>(); // text -> fresh id, only for ambiguous line ids
+        int firstFreeId = dictionary.getLineCount();
+        oldIds = new int[oldLines.size()];
+        for (int i = 0; i < oldIds.length; i++) {
+            oldIds[i] = idOf(oldLines.get(i), dictionary, split, firstFreeId);
+        }
+        newIds = new int[newLines.size()];
+        for (int i = 0; i < newIds.length; i++) {
+            newIds[i] = idOf(newLines.get(i), dictionary, split, firstFreeId);
+        }
+    }
+
+    private static int idOf(LineRecord line, TokenDictionary dictionary, Map<String, Integer> split, int firstFreeId) {
+        int id = line.getLineId();
+        if (!dictionary.isAmbiguousLine(id)) {
+            return id;
+        }
+        return split.computeIfAbsent(line.getNormalizedTextUncached(), t -> firstFreeId + split.size());
+    }
+
+    private void match(int oldIndex, int newIndex) { // 0-based indexes -> 1-based line numbers
+        mapping.put(oldIndex + 1, newIndex + 1);
+    }
+
+    // Diff old[aLo, aHi) against new[bLo, bHi)
+    private void diffRange(int aLo, int aHi, int bLo, int bHi) {
+        // trim again, gaps between anchors often share a prefix/suffix too
+        while (aLo < aHi && bLo < bHi && oldIds[aLo] == newIds[bLo]) {
+            match(aLo++, bLo++);
+        }
+        while (aLo < aHi && bLo < bHi && oldIds[aHi - 1] == newIds[bHi - 1]) {
+            match(--aHi, --bHi);
+        }
+        if (aLo == aHi || bLo == bHi) {
+            return; // pure insertion or deletion
+        }
+
+        List<int[]> anchors = patienceAnchors(aLo, aHi, bLo, bHi);
+        if (anchors.isEmpty()) {
+            myers(aLo, aHi, bLo, bHi);
+            return;
+        }
+
+        int prevA = aLo;
+        int prevB = bLo;
+        for (int[] anchor : anchors) {
+            diffRange(prevA, anchor[0], prevB, anchor[1]);
+            match(anchor[0], anchor[1]);
+            prevA = anchor[0] + 1;
+            prevB = anchor[1] + 1;
+        }
+        diffRange(prevA, aHi, prevB, bHi);
+    }
+
+    // Lines unique in both ranges, reduced to the longest in-order chain.
+    // Returns (oldIndex, newIndex) pairs sorted by both indexes.
+    private List<int[]> patienceAnchors(int aLo, int aHi, int bLo, int bHi) {
+        // id -> {count in old, index in old, count in new, index in new}
+        Map<Integer, int[]> counts = new HashMap<>();
+        for (int i = aLo; i < aHi; i++) {
+            int[] c = counts.computeIfAbsent(oldIds[i], id -> new int[4]);
+            c[0]++;
+            c[1] = i;
+        }
+        for (int j = bLo; j < bHi; j++) {
+            int[] c = counts.get(newIds[j]);
+            if (c == null) continue; // not in old range at all
+            c[2]++;
+            c[3] = j;
+        }
+
+        List<int[]> unique = new ArrayList<>(); // in old order
+        for (int i = aLo; i < aHi; i++) {
+            int[] c = counts.get(oldIds[i]);
+            if (c[0] == 1 && c[2] == 1) {
+                unique.add(new int[]{i, c[3]});
+            }
+        }
+        if (unique.isEmpty()) {
+            return unique;
+        }
+
+        // Longest increasing subsequence on new indexes (patience sorting)
+        int k = unique.size();
+        int[] tails = new int[k];   // index into 'unique' of the smallest tail for each length
+        int[] previous = new int[k];
+        int length = 0;
+        for (int u = 0; u < k; u++) {
+            int b = unique.get(u)[1];
+            int lo = 0;
+            int hi = length;
+            while (lo < hi) {
+                int mid = (lo + hi) >>> 1;
+                if (unique.get(tails[mid])[1] < b) lo = mid + 1;
+                else hi = mid;
+            }
+            previous[u] = lo > 0 ? tails[lo - 1] : -1;
+            tails[lo] = u;
+            if (lo == length) length++;
+        }
+
+        int[][] chain = new int[length][];
+        for (int u = tails[length - 1], pos = length - 1; u != -1; u = previous[u], pos--) {
+            chain[pos] = unique.get(u);
+        }
+        return List.of(chain);
+    }
+
+    // Myers' greedy O(ND) diff on old[aLo, aHi) vs new[bLo, bHi), recording the snakes
+    private void myers(int aLo, int aHi, int bLo, int bHi) {
+        int n = aHi - aLo;
+        int m = bHi - bLo;
+        int maxD = Math.min(n + m, MAX_EDIT_DISTANCE);
+        int offset = maxD + 1;
+        int[] v = new int[2 * maxD + 3];
+        List<int[]> trace = new ArrayList<>(); // trace.get(d)[k + d] = furthest x on diagonal k
+
+        for (int d = 0; d <= maxD; d++) {
+            for (int k = -d; k <= d; k += 2) {
+                int x;
+                if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) {
+                    x = v[offset + k + 1]; // step down (insertion)
+                } else {
+                    x = v[offset + k - 1] + 1; // step right (deletion)
+                }
+                int y = x - k;
+                while (x < n && y < m && oldIds[aLo + x] == newIds[bLo + y]) {
+                    x++;
+                    y++;
+                }
+                v[offset + k] = x;
+
+                if (x >= n && y >= m) {
+                    int[] snapshot = new int[2 * d + 1];
+                    System.arraycopy(v, offset - d, snapshot, 0, snapshot.length);
+                    trace.add(snapshot);
+                    backtrack(trace, aLo, bLo, n, m);
+                    return;
+                }
+            }
+            int[] snapshot = new int[2 * d + 1];
+            System.arraycopy(v, offset - d, snapshot, 0, snapshot.length);
+            trace.add(snapshot);
+        }
+
+        // Too different for Myers, keep whatever in-order exact matches are easy to find
+        greedyInOrder(aLo, aHi, bLo, bHi);
+    }
+
+    private void backtrack(List<int[]> trace, int aLo, int bLo, int n, int m) {
+        int x = n;
+        int y = m;
+        for (int d = trace.size() - 1; d > 0; d--) {
+            int[] prev = trace.get(d - 1); // prev[k + d - 1]
+            int k = x - y;
+            boolean down = k == -d || (k != d && prev[k - 1 + d - 1] < prev[k + 1 + d - 1]);
+            int prevK = down ? k + 1 : k - 1;
+            int prevX = prev[prevK + d - 1];
+            int prevY = prevX - prevK;
+            int snakeStartX = down ? prevX : prevX + 1;
+
+            while (x > snakeStartX) { // diagonal moves are matches
+                x--;
+                y--;
+                match(aLo + x, bLo + y);
+            }
+            x = prevX;
+            y = prevY;
+        }
+        while (x > 0 && y > 0) { // the d = 0 snake
+            x--;
+            y--;
+            match(aLo + x, bLo + y);
+        }
+    }
+
+    // For each old line, take the next unused equal new line after the last match
+    private void greedyInOrder(int aLo, int aHi, int bLo, int bHi) {
+        Map<Integer, ArrayDeque<Integer>> positions = new HashMap<>();
+        for (int j = bLo; j < bHi; j++) {
+            positions.computeIfAbsent(newIds[j], id -> new ArrayDeque<>()).addLast(j);
+        }
+        int lastB = bLo - 1;
+        for (int i = aLo; i < aHi; i++) {
+            ArrayDeque<Integer> queue = positions.get(oldIds[i]);
+            if (queue == null) continue;
+            while (!queue.isEmpty() && queue.peekFirst() <= lastB) {
+                queue.pollFirst(); // already behind us
+            }
+            if (!queue.isEmpty()) {
+                lastB = queue.pollFirst();
+                match(i, lastB);
+            }
+        }
+    }
+}
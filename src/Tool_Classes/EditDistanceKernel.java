@@ -0,0 +1,210 @@
+package tool;
+
+
+import java.util.Arrays;
+
+/**
+ * Levenshtein distance of two lines with Myers' bit-parallel algorithm
+ * (in Hyyrö's formulation), instead of the (m+1) x (n+1) DP table.
+ *
+ * The shorter string is the "pattern": bit i of a word stands for its row i, and
+ * one column of the DP table (one char of the other string) is a handful of
+ * AND/OR/XOR/add on those words. Up to 64 chars that is a single long per column;
+ * longer patterns are cut into 64-row blocks and the horizontal deltas are carried
+ * from one block to the next.
+ *
+ * Every call takes a maxDistance. As soon as the distance cannot come back under
+ * it (each remaining column lowers the last row by at most 1) we stop and return
+ * maxDistance + 1, so pairs that are far apart cost a few columns, not the line.
+ */
+public final class EditDistanceKernel {
+
+    private static final int ASCII = 128;
+
+    // per thread pattern masks, reused across calls (scoring runs on a pool)
+    private static final ThreadLocal<Masks> MASKS = ThreadLocal.withInitial(Masks::new);
+
+    private EditDistanceKernel() {
+    }
+
+    /**
+     * Levenshtein distance of a and b, or maxDistance + 1 if it is larger than maxDistance.
+     */
+    public static int distance(CharSequence a, CharSequence b, int maxDistance) {
+        CharSequence pattern = a.length() <= b.length() ? a : b;
+        CharSequence text = pattern == a ? b : a;
+        int m = pattern.length();
+        int n = text.length();
+
+        if (n - m > maxDistance) {
+            return maxDistance + 1; // the length difference alone is too much
+        }
+        if (m == 0) {
+            return n;
+        }
+
+        Masks masks = MASKS.get();
+        masks.build(pattern);
+        try {
+            return m <= 64
+                    ? singleWord(masks, m, text, maxDistance)
+                    : blocked(masks, m, text, maxDistance);
+        } finally {
+            masks.clear(pattern);
+        }
+    }
+
+    /**
+     * 1 - distance / longer length, with the same early exit: when the similarity would
+     * be below minSimilarity the result is only guaranteed to be below it too.
+     */
+    public static double similarity(CharSequence a, CharSequence b, double minSimilarity) {
+        int longer = Math.max(a.length(), b.length());
+        if (longer == 0) {
+            return 1.0;
+        }
+        int maxDistance = (int) Math.floor((1.0 - Math.max(0.0, minSimilarity)) * longer);
+        int distance = distance(a, b, maxDistance);
+        return 1.0 - (double) Math.min(distance, longer) / longer;
+    }
+
+    // pattern of at most 64 chars: the whole column is one long
+    private static int singleWord(Masks masks, int m, CharSequence text, int maxDistance) {
+        int n = text.length();
+        long vp = ~0L; // vertical +1 deltas (bits above m are junk, but carries only go up)
+        long vn = 0L;  // vertical -1 deltas
+        long last = 1L << (m - 1);
+        int distance = m;
+
+        for (int j = 0; j < n; j++) {
+            long eq = masks.get(text.charAt(j), 0);
+            long d0 = (((eq & vp) + vp) ^ vp) | eq | vn;
+            long hp = vn | ~(d0 | vp);
+            long hn = d0 & vp;
+            if ((hp & last) != 0) distance++;
+            else if ((hn & last) != 0) distance--;
+            if (distance - (n - j - 1) > maxDistance) {
+                return maxDistance + 1;
+            }
+            hp = (hp << 1) | 1; // row 0 is D[0][j] = j, so it always goes up by one
+            hn <<= 1;
+            vp = hn | ~(d0 | hp);
+            vn = hp & d0;
+        }
+        return distance;
+    }
+
+    // longer pattern: one long per 64 rows, horizontal deltas carried down the blocks
+    private static int blocked(Masks masks, int m, CharSequence text, int maxDistance) {
+        int n = text.length();
+        int blocks = (m + 63) >>> 6;
+        long[] vp = masks.vp;
+        long[] vn = masks.vn;
+        Arrays.fill(vp, 0, blocks, ~0L);
+        Arrays.fill(vn, 0, blocks, 0L);
+        long last = 1L << ((m - 1) & 63);
+        int distance = m;
+
+        for (int j = 0; j < n; j++) {
+            char c = text.charAt(j);
+            long hpCarry = 1; // row 0 goes up by one
+            long hnCarry = 0;
+            for (int w = 0; w < blocks; w++) {
+                long eq = masks.get(c, w);
+                long x = eq | hnCarry;
+                long d0 = (((x & vp[w]) + vp[w]) ^ vp[w]) | x | vn[w];
+                long hp = vn[w] | ~(d0 | vp[w]);
+                long hn = d0 & vp[w];
+
+                long hpIn = hpCarry;
+                long hnIn = hnCarry;
+                if (w < blocks - 1) {
+                    hpCarry = hp >>> 63;
+                    hnCarry = hn >>> 63;
+                } else {
+                    hpCarry = (hp & last) != 0 ? 1 : 0;
+                    hnCarry = (hn & last) != 0 ? 1 : 0;
+                }
+                hp = (hp << 1) | hpIn;
+                hn = (hn << 1) | hnIn;
+                vp[w] = hn | ~(d0 | hp);
+                vn[w] = hp & d0;
+            }
+            distance += (int) hpCarry - (int) hnCarry;
+            if (distance - (n - j - 1) > maxDistance) {
+                return maxDistance + 1;
+            }
+        }
+        return distance;
+    }
+
+    // ----- helpers -----
+
+    // Peq masks of the current pattern: bit i of block w set where pattern[64w + i] == c.
+    // ASCII chars index a flat table, anything else goes to a short list (rare in code).
+    private static final class Masks {
+        private long[] ascii = new long[ASCII];  // [c * blocks + w]
+        private char[] otherChars = new char[8];
+        private long[] otherMasks = new long[8]; // [k * blocks + w]
+        private int otherCount;
+        private int blocks = 1;
+        long[] vp = new long[1];
+        long[] vn = new long[1];
+
+        void build(CharSequence pattern) {
+            int m = pattern.length();
+            blocks = (m + 63) >>> 6;
+            if (ascii.length < ASCII * blocks) {
+                ascii = new long[ASCII * blocks];
+                vp = new long[blocks];
+                vn = new long[blocks];
+            }
+            for (int i = 0; i < m; i++) {
+                char c = pattern.charAt(i);
+                long bit = 1L << i; // shift uses the low 6 bits
+                int w = i >>> 6;
+                if (c < ASCII) {
+                    ascii[c * blocks + w] |= bit;
+                } else {
+                    otherMasks[otherIndex(c) * blocks + w] |= bit;
+                }
+            }
+        }
+
+        long get(char c, int w) {
+            if (c < ASCII) {
+                return ascii[c * blocks + w];
+            }
+            for (int k = 0; k < otherCount; k++) {
+                if (otherChars[k] == c) return otherMasks[k * blocks + w];
+            }
+            return 0L;
+        }
+
+        // zero only what build set, so the tables stay cheap to reuse
+        void clear(CharSequence pattern) {
+            for (int i = 0; i < pattern.length(); i++) {
+                char c = pattern.charAt(i);
+                if (c < ASCII) {
+                    Arrays.fill(ascii, c * blocks, (c + 1) * blocks, 0L);
+                }
+            }
+            Arrays.fill(otherMasks, 0, otherCount * blocks, 0L);
+            otherCount = 0;
+        }
+
+        private int otherIndex(char c) {
+            for (int k = 0; k < otherCount; k++) {
+                if (otherChars[k] == c) return k;
+            }
+            if (otherCount == otherChars.length) {
+                otherChars = Arrays.copyOf(otherChars, 2 * otherCount);
+            }
+            if (otherMasks.length < (otherCount + 1) * blocks) {
+                otherMasks = Arrays.copyOf(otherMasks, Math.max(2 * otherMasks.length, (otherCount + 1) * blocks));
+            }
+            otherChars[otherCount] = c;
+            return otherCount++;
+        }
+    }
+}
@@ -0,0 +1,322 @@
+package tool;
+
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Locale;
+import java.util.Random;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+
+/**
+ * SYNTHETIC PAIRS:
+ * Builds an old/new pair of any size from a seed source file, together with the exact
+ * expected mapping, for scaling tests (PipelineBenchmark) and accuracy checks (EvaluationRunner).
+ *
+ *  old = the seed lines repeated until there are enough; every copy after the first gets
+ *        its identifiers renamed (name -> name_3), so copies are not exact duplicates
+ *  new = old after random edits, each old line at most one of:
+ *        deleted, modified (one identifier or number changed), split into two lines,
+ *        whitespace changed (indentation / inner spaces)
+ *        plus new lines inserted in between and whole blocks moved elsewhere
+ *
+ * The expected mapping is in our own "ORIG NEW" format; a split line maps to its first part,
+ * like the Mapper does. The same seed and settings always give the same pair.
+ */
+public class EditGenerator {
+
+    private static final String USAGE = String.join("\n",
+            "Usage: java tool.EditGenerator [--lines=N] [--seed=N] [--insert=X] [--delete=X] [--modify=X]",
+            "                               [--split=X] [--whitespace=X] [--move=X] <seedFile> <outDir>",
+            "  writes <outDir>/<name>-old.<ext>, <name>-new.<ext> and <name>-expected.map.txt",
+            "  X are per-line probabilities (defaults 0.04 0.04 0.08 0.01 0.02 0.005)");
+
+    private static final Pattern IDENTIFIER = Pattern.compile("\\b([A-Za-z_][A-Za-z0-9_]{2,})\\b");
+    private static final Pattern NUMBER = Pattern.compile("\\b\\d+\\b");
+
+    private int lines = 10_000;        // old lines
+    private double insertRate = 0.04;  // new line inserted before an old line
+    private double deleteRate = 0.04;
+    private double modifyRate = 0.08;
+    private double splitRate = 0.01;
+    private double whitespaceRate = 0.02;
+    private double moveRate = 0.005;   // a block of 3-12 lines moved, per old line
+
+    /**
+     * One generated pair; expected[i] is the new line of old line i + 1, or -1.
+     */
+    public static final class Result {
+        public final List<String> oldLines;
+        public final List<String> newLines;
+        public final int[] expected;
+
+        Result(List<String> oldLines, List<String> newLines, int[] expected) {
+            this.oldLines = oldLines;
+            this.newLines = newLines;
+            this.expected = expected;
+        }
+
+        /**
+         * Expected mapping as MappingEntries (status: unchanged, modified or deleted).
+         */
+        public List<MappingEntry> expectedEntries() {
+            List<MappingEntry> entries = new ArrayList<>(expected.length);
+            for (int i = 0; i < expected.length; i++) {
+                String status;
+                if (expected[i] == -1) {
+                    status = "deleted";
+                } else if (oldLines.get(i).equals(newLines.get(expected[i] - 1))) {
+                    status = "unchanged";
+                } else {
+                    status = "modified";
+                }
+                entries.add(new MappingEntry(i + 1, expected[i], status));
+            }
+            return entries;
+        }
+
+        /**
+         * Write name-old.ext, name-new.ext and name-expected.map.txt into dir.
+         *
+         * @return {old, new, expected mapping}
+         */
+        public Path[] write(Path dir, String name, String extension) throws IOException {
+            Files.createDirectories(dir);
+            Path oldPath = dir.resolve(name + "-old." + extension);
+            Path newPath = dir.resolve(name + "-new." + extension);
+            Path expectedPath = dir.resolve(name + "-expected.map.txt");
+            Files.write(oldPath, oldLines, StandardCharsets.UTF_8);
+            Files.write(newPath, newLines, StandardCharsets.UTF_8);
+            new MappingWriter().writeMapping(expectedPath.toString(), expectedEntries());
+            return new Path[]{oldPath, newPath, expectedPath};
+        }
+    }
+
+    // one line of the new file while we build it: text + the old line it came from (0 = inserted)
+    private static final class NewLine {
+        final String text;
+        final int origin;
+
+        NewLine(String text, int origin) {
+            this.text = text;
+            this.origin = origin;
+        }
+    }
+
+    public EditGenerator setLines(int lines) {
+        this.lines = lines;
+        return this;
+    }
+
+    public EditGenerator setInsertRate(double insertRate) {
+        this.insertRate = insertRate;
+        return this;
+    }
+
+    public EditGenerator setDeleteRate(double deleteRate) {
+        this.deleteRate = deleteRate;
+        return this;
+    }
+
+    public EditGenerator setModifyRate(double modifyRate) {
+        this.modifyRate = modifyRate;
+        return this;
+    }
+
+    public EditGenerator setSplitRate(double splitRate) {
+        this.splitRate = splitRate;
+        return this;
+    }
+
+    public EditGenerator setWhitespaceRate(double whitespaceRate) {
+        this.whitespaceRate = whitespaceRate;
+        return this;
+    }
+
+    public EditGenerator setMoveRate(double moveRate) {
+        this.moveRate = moveRate;
+        return this;
+    }
+
+    public static void main(String[] args) throws IOException {
+        EditGenerator generator = new EditGenerator();
+        long seed = 42;
+        List<String> files = new ArrayList<>();
+        for (String arg : args) {
+            int eq = arg.indexOf('=');
+            String value = eq < 0 ? "" : arg.substring(eq + 1);
+            if (arg.startsWith("--lines=")) {
+                generator.setLines(Integer.parseInt(value));
+            } else if (arg.startsWith("--seed=")) {
+                seed = Long.parseLong(value);
+            } else if (arg.startsWith("--insert=")) {
+                generator.setInsertRate(Double.parseDouble(value));
+            } else if (arg.startsWith("--delete=")) {
+                generator.setDeleteRate(Double.parseDouble(value));
+            } else if (arg.startsWith("--modify=")) {
+                generator.setModifyRate(Double.parseDouble(value));
+            } else if (arg.startsWith("--split=")) {
+                generator.setSplitRate(Double.parseDouble(value));
+            } else if (arg.startsWith("--whitespace=")) {
+                generator.setWhitespaceRate(Double.parseDouble(value));
+            } else if (arg.startsWith("--move=")) {
+                generator.setMoveRate(Double.parseDouble(value));
+            } else if (arg.startsWith("--")) {
+                System.err.println("Unknown option: " + arg);
+                System.exit(1);
+            } else {
+                files.add(arg);
+            }
+        }
+        if (files.size() != 2) {
+            System.err.println(USAGE);
+            System.exit(1);
+        }
+
+        Path seedFile = Path.of(files.get(0));
+        Result result = generator.generate(readSeed(seedFile), seed);
+        String name = baseName(seedFile) + "-" + generator.lines;
+        Path[] written = result.write(Path.of(files.get(1)), name, extension(seedFile));
+        System.out.printf(Locale.ROOT, "%s (%,d lines)%n%s (%,d lines)%n%s%n",
+                written[0], result.oldLines.size(), written[1], result.newLines.size(), written[2]);
+    }
+
+    /**
+     * Seed lines of a file, decoded like the Preprocessor does (bad bytes replaced).
+     */
+    public static List<String> readSeed(Path seedFile) throws IOException {
+        MappedLines text = MappedLines.map(seedFile);
+        List<String> seedLines = new ArrayList<>(text.size());
+        for (int i = 0; i < text.size(); i++) seedLines.add(text.getLine(i));
+        return seedLines;
+    }
+
+    /**
+     * Generate one pair from the seed lines.
+     */
+    public Result generate(List<String> seedLines, long seed) {
+        if (seedLines.isEmpty()) {
+            throw new IllegalArgumentException("seed file has no lines");
+        }
+        Random random = new Random(seed);
+
+        // old: seed copies, renamed after the first
+        List<String> oldLines = new ArrayList<>(lines);
+        for (int copy = 0; oldLines.size() < lines; copy++) {
+            for (int i = 0; i < seedLines.size() && oldLines.size() < lines; i++) {
+                String line = seedLines.get(i);
+                oldLines.add(copy == 0 ? line : IDENTIFIER.matcher(line).replaceAll("$1_" + copy));
+            }
+        }
+
+        // per-line edits
+        List<NewLine> building = new ArrayList<>(lines + lines / 8);
+        int inserted = 0;
+        for (int oldLine = 1; oldLine <= oldLines.size(); oldLine++) {
+            if (random.nextDouble() < insertRate) {
+                String template = seedLines.get(random.nextInt(seedLines.size()));
+                String text = IDENTIFIER.matcher(template).replaceAll("$1_ins" + (++inserted));
+                building.add(new NewLine(text, 0));
+            }
+
+            String line = oldLines.get(oldLine - 1);
+            double edit = random.nextDouble();
+            if ((edit -= deleteRate) < 0) {
+                continue;
+            }
+            if ((edit -= modifyRate) < 0) {
+                building.add(new NewLine(modify(line, random), oldLine));
+            } else if ((edit -= splitRate) < 0) {
+                int cut = splitPoint(line);
+                if (cut < 0) {
+                    building.add(new NewLine(line, oldLine));
+                } else {
+                    building.add(new NewLine(line.substring(0, cut), oldLine));
+                    building.add(new NewLine(indentOf(line) + "        " + line.substring(cut + 1).trim(), 0));
+                }
+            } else if ((edit -= whitespaceRate) < 0) {
+                building.add(new NewLine(changeWhitespace(line, random), oldLine));
+            } else {
+                building.add(new NewLine(line, oldLine));
+            }
+        }
+
+        // block moves: cut a block out and put it back somewhere else
+        int moves = (int) Math.round(oldLines.size() * moveRate);
+        for (int m = 0; m < moves && building.size() > 24; m++) {
+            int length = 3 + random.nextInt(10);
+            int from = random.nextInt(building.size() - length);
+            List<NewLine> block = new ArrayList<>(building.subList(from, from + length));
+            building.subList(from, from + length).clear();
+            int to = random.nextInt(building.size() + 1);
+            building.addAll(to, block);
+        }
+
+        List<String> newLines = new ArrayList<>(building.size());
+        int[] expected = new int[oldLines.size()];
+        Arrays.fill(expected, -1);
+        for (NewLine line : building) {
+            newLines.add(line.text);
+            if (line.origin > 0) expected[line.origin - 1] = newLines.size();
+        }
+        return new Result(oldLines, newLines, expected);
+    }
+
+    // ----- edits -----
+
+    // change one identifier or number; lines without either stay as they are
+    private static String modify(String line, Random random) {
+        List<int[]> spots = new ArrayList<>();
+        Matcher id = IDENTIFIER.matcher(line);
+        while (id.find()) spots.add(new int[]{id.start(), id.end(), 0});
+        Matcher number = NUMBER.matcher(line);
+        while (number.find()) spots.add(new int[]{number.start(), number.end(), 1});
+        if (spots.isEmpty()) {
+            return line;
+        }
+        int[] spot = spots.get(random.nextInt(spots.size()));
+        String replacement = line.substring(spot[0], spot[1]) + (spot[2] == 1 ? "1" : "Changed"); // 10 -> 101
+        return line.substring(0, spot[0]) + replacement + line.substring(spot[1]);
+    }
+
+    // a space near the middle of the code (not in the indentation), or -1
+    private static int splitPoint(String line) {
+        int start = indentOf(line).length();
+        int middle = (start + line.length()) / 2;
+        for (int d = 0; d < line.length(); d++) {
+            if (middle + d < line.length() && line.charAt(middle + d) == ' ') return middle + d;
+            if (middle - d > start && line.charAt(middle - d) == ' ') return middle - d;
+        }
+        return -1;
+    }
+
+    private static String changeWhitespace(String line, Random random) {
+        if (random.nextBoolean() || line.indexOf(' ', indentOf(line).length()) < 0) {
+            return "    " + line; // indentation
+        }
+        int space = line.indexOf(' ', indentOf(line).length());
+        return line.substring(0, space) + "  " + line.substring(space); // inner spaces
+    }
+
+    private static String indentOf(String line) {
+        int i = 0;
+        while (i < line.length() && Character.isWhitespace(line.charAt(i))) i++;
+        return line.substring(0, i);
+    }
+
+    private static String baseName(Path file) {
+        String name = file.getFileName().toString();
+        int dot = name.lastIndexOf('.');
+        return (dot > 0 ? name.substring(0, dot) : name).replace(' ', '_');
+    }
+
+    static String extension(Path file) {
+        String name = file.getFileName().toString();
+        int dot = name.lastIndexOf('.');
+        return dot > 0 ? name.substring(dot + 1) : "txt";
+    }
+}
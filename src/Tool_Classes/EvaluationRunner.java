@@ -0,0 +1,364 @@
+package tool;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+
+/**
+ * EVALUATION:
+ * Maps every sample pair that has ground truth and scores the result against it, so a
+ * speed-up and its effect on accuracy show up in the same run.
+ *
+ * Pairs come from:
+ *  - file_mapping/ (or --samples=<dir>): SamplePairs + GroundTruth.findFor
+ *  - --manifest=<file>: one "old<TAB>new<TAB>groundTruth" per line, for ground truth
+ *    without sources next to it (e.g. PROF_evaluation/*_map.txt)
+ *  - --synthetic=1000,100000: EditGenerator pairs of those sizes with their exact expected
+ *    mapping, grown from --seed-file (default: the biggest sample file)
+ *
+ * Per pair, over the old lines the ground truth lists:
+ *   precision = correct matches / lines we mapped (new != -1)
+ *   recall    = correct matches / lines the ground truth maps
+ *   accuracy  = lines where we agree with the ground truth, deletions included
+ * plus lines/s of Steps 2-5 (old + new lines / mapping time). Pairs run in parallel
+ * on --jobs threads; the totals are summed over all pairs. With --stats the share of
+ * candidate pairs the Step 4 upper bound skipped is shown too ("pruned").
+ *
+ *   java tool.EvaluationRunner [--samples=<dir>] [--manifest=<file>] [--synthetic=N,...] [--seed-file=<file>]
+ *        [--jobs=N] [--json=<file>] [options]
+ */
+public class EvaluationRunner {
+
+    private static final String USAGE = String.join("\n",
+            "Usage: java tool.EvaluationRunner [--samples=<dir>] [--manifest=<file>] [--synthetic=N,...] [--seed-file=<file>]",
+            "                                  [--jobs=N] [--json=<file>] [options]",
+            "  --samples=<dir>   sample folder to search for pairs + ground truth (default file_mapping, empty = none)",
+            "  --manifest=<file> extra pairs, one old<TAB>new<TAB>groundTruth per line",
+            "  --synthetic=N,... also generated pairs of N old lines each (EditGenerator, exact expected mapping)",
+            "  --seed-file=<f>   seed for --synthetic (default: the biggest sample file)",
+            "  --jobs=N          pairs evaluated at the same time (default: number of cores)",
+            "  --json=<file>     also write the results as JSON");
+
+    /**
+     * One pair to evaluate.
+     */
+    static final class Case {
+        final String name;
+        final Path oldPath;
+        final Path newPath;
+        final Path truthPath;
+
+        Case(String name, Path oldPath, Path newPath, Path truthPath) {
+            this.name = name;
+            this.oldPath = oldPath;
+            this.newPath = newPath;
+            this.truthPath = truthPath;
+        }
+    }
+
+    /**
+     * Scores of one pair.
+     */
+    static final class Result {
+        final String name;
+        int lines;          // old + new lines
+        int evaluated;      // ground truth old lines that exist in the old file
+        int expectedMapped; // of those, mapped (not -1) by the ground truth
+        int predictedMapped;
+        int correctMapped;  // same new line, not -1
+        int agreed;         // same new line, -1 included
+        double mapMs;
+        long pairsScored;   // Step 4 counters, only filled with --stats
+        long pairsPruned;
+
+        Result(String name) {
+            this.name = name;
+        }
+
+        double precision() {
+            return predictedMapped == 0 ? 1.0 : (double) correctMapped / predictedMapped;
+        }
+
+        double recall() {
+            return expectedMapped == 0 ? 1.0 : (double) correctMapped / expectedMapped;
+        }
+
+        double accuracy() {
+            return evaluated == 0 ? 1.0 : (double) agreed / evaluated;
+        }
+
+        double linesPerSecond() {
+            return mapMs == 0 ? 0 : lines / (mapMs / 1000.0);
+        }
+
+        double pruneRate() {
+            long total = pairsScored + pairsPruned;
+            return total == 0 ? 0.0 : (double) pairsPruned / total;
+        }
+
+        void add(Result other) {
+            lines += other.lines;
+            evaluated += other.evaluated;
+            expectedMapped += other.expectedMapped;
+            predictedMapped += other.predictedMapped;
+            correctMapped += other.correctMapped;
+            agreed += other.agreed;
+            mapMs += other.mapMs;
+            pairsScored += other.pairsScored;
+            pairsPruned += other.pairsPruned;
+        }
+    }
+
+    private final MappingOptions options;
+    private final int jobs;
+
+    public EvaluationRunner(MappingOptions options, int jobs) {
+        this.options = options;
+        this.jobs = jobs;
+    }
+
+    public static void main(String[] args) throws IOException {
+        MappingOptions options = new MappingOptions();
+        int jobs = Runtime.getRuntime().availableProcessors();
+        Path samples = Path.of("file_mapping");
+        Path manifest = null;
+        Path seedFile = null;
+        int[] syntheticSizes = new int[0];
+        String json = null;
+
+        for (String arg : args) {
+            boolean ok = true;
+            try {
+                if (arg.startsWith("--samples=")) {
+                    String value = arg.substring("--samples=".length());
+                    samples = value.isEmpty() ? null : Path.of(value);
+                } else if (arg.startsWith("--manifest=")) {
+                    manifest = Path.of(arg.substring("--manifest=".length()));
+                } else if (arg.startsWith("--synthetic=")) {
+                    syntheticSizes = Arrays.stream(arg.substring("--synthetic=".length()).split(","))
+                            .mapToInt(v -> MappingOptions.parsePositive(v.trim())).toArray();
+                } else if (arg.startsWith("--seed-file=")) {
+                    seedFile = Path.of(arg.substring("--seed-file=".length()));
+                } else if (arg.startsWith("--jobs=")) {
+                    jobs = MappingOptions.parsePositive(arg.substring("--jobs=".length()));
+                } else if (arg.startsWith("--json=")) {
+                    json = arg.substring("--json=".length());
+                } else {
+                    ok = options.applyFlag(arg);
+                }
+            } catch (IllegalArgumentException ex) { // not a number, or below 1
+                ok = false;
+            }
+            if (!ok) {
+                System.err.println("Unknown option or bad value: " + arg);
+                System.err.println(USAGE);
+                System.err.println(MappingOptions.USAGE);
+                System.exit(1);
+            }
+        }
+
+        List<Case> cases = new ArrayList<>();
+        List<SamplePairs.Pair> samplePairs = new ArrayList<>();
+        if (samples != null && Files.isDirectory(samples)) {
+            samplePairs = SamplePairs.find(samples);
+            cases.addAll(casesFromSamples(samples, samplePairs));
+        }
+        if (manifest != null) {
+            cases.addAll(casesFromManifest(manifest));
+        }
+        Path syntheticDir = null;
+        if (syntheticSizes.length > 0) {
+            syntheticDir = Files.createTempDirectory("evaluation");
+            List<String> seedLines = seedFile != null ? EditGenerator.readSeed(seedFile)
+                    : PipelineBenchmark.defaultSeed(samplePairs);
+            cases.addAll(syntheticCases(syntheticDir, seedLines, syntheticSizes));
+        }
+        if (cases.isEmpty()) {
+            System.err.println("No pairs with ground truth found.");
+            System.exit(1);
+        }
+
+        try {
+            List<Result> results = new EvaluationRunner(options, jobs).evaluateAll(cases);
+            print(results);
+            if (json != null) {
+                Files.writeString(Path.of(json), toJson(results));
+            }
+        } finally {
+            if (syntheticDir != null) {
+                PipelineBenchmark.deleteTree(syntheticDir);
+            }
+        }
+    }
+
+    /**
+     * Evaluate every case on the pool; results come back in case order.
+     * A case that fails is reported and left out.
+     */
+    public List<Result> evaluateAll(List<Case> cases) {
+        ExecutorService pool = Executors.newFixedThreadPool(Math.max(1, jobs));
+        List<Future<Result>> futures = new ArrayList<>(cases.size());
+        try {
+            for (Case c : cases) {
+                futures.add(pool.submit(() -> evaluate(c)));
+            }
+            List<Result> results = new ArrayList<>(cases.size());
+            for (int i = 0; i < futures.size(); i++) {
+                try {
+                    results.add(futures.get(i).get());
+                } catch (ExecutionException ex) {
+                    System.err.println("FAILED " + cases.get(i).name + ": " + ex.getCause());
+                }
+            }
+            return results;
+        } catch (InterruptedException ex) {
+            Thread.currentThread().interrupt();
+            throw new RuntimeException(ex);
+        } finally {
+            pool.shutdown();
+        }
+    }
+
+    /**
+     * Map one pair and compare it to its ground truth.
+     */
+    public Result evaluate(Case c) throws IOException {
+        Preprocessor preprocessor = LineMappingTool.newPreprocessor(options);
+        FileVersion oldFile = preprocessor.loadFile(c.oldPath.toString());
+        FileVersion newFile = preprocessor.loadFile(c.newPath.toString());
+
+        PipelineMetrics metrics = PipelineMetrics.forRun(options); // null without --stats/--report/JFR
+        long start = System.nanoTime();
+        List<MappingEntry> mapping = new LineMappingTool().map(oldFile, newFile, options, metrics);
+        long elapsed = System.nanoTime() - start;
+
+        Result result = score(c.name, mapping, GroundTruth.read(c.truthPath));
+        result.lines = oldFile.getLines().size() + newFile.getLines().size();
+        result.mapMs = elapsed / 1e6;
+        if (metrics != null) {
+            metrics.finish(oldFile, newFile);
+            result.pairsScored = metrics.pairsScored.sum();
+            result.pairsPruned = metrics.pairsPruned.sum();
+        }
+        return result;
+    }
+
+    /**
+     * Compare a mapping with the expected one, over the old lines the expectation lists.
+     */
+    static Result score(String name, List<MappingEntry> mapping, Map<Integer, Integer> expected) {
+        int[] predicted = new int[mapping.size() + 1]; // old line -> new line
+        for (MappingEntry entry : mapping) {
+            if (entry.oldLine > 0 && entry.oldLine < predicted.length) predicted[entry.oldLine] = entry.newLine;
+        }
+
+        Result result = new Result(name);
+        for (Map.Entry<Integer, Integer> e : expected.entrySet()) {
+            int oldLine = e.getKey();
+            if (oldLine >= predicted.length) {
+                continue; // ground truth for a line the file does not have
+            }
+            int want = e.getValue();
+            int got = predicted[oldLine];
+            result.evaluated++;
+            if (want != -1) result.expectedMapped++;
+            if (got != -1) result.predictedMapped++;
+            if (got == want) {
+                result.agreed++;
+                if (want != -1) result.correctMapped++;
+            }
+        }
+        return result;
+    }
+
+    static List<Case> casesFromSamples(Path root, List<SamplePairs.Pair> pairs) throws IOException {
+        List<Case> cases = new ArrayList<>();
+        for (SamplePairs.Pair pair : pairs) {
+            Path truth = GroundTruth.findFor(pair);
+            if (truth == null) {
+                System.err.println("No ground truth for " + pair + ", skipped");
+                continue;
+            }
+            cases.add(new Case(root.relativize(pair.oldPath).toString(), pair.oldPath, pair.newPath, truth));
+        }
+        return cases;
+    }
+
+    static List<Case> casesFromManifest(Path manifest) throws IOException {
+        Path base = manifest.toAbsolutePath().getParent();
+        List<Case> cases = new ArrayList<>();
+        for (String line : Files.readAllLines(manifest)) {
+            if (line.isBlank() || line.startsWith("#")) {
+                continue;
+            }
+            String[] parts = line.split("\t");
+            if (parts.length < 3) {
+                System.err.println("Skipping manifest line (need old<TAB>new<TAB>groundTruth): " + line);
+                continue;
+            }
+            cases.add(new Case(parts[0].trim(), base.resolve(parts[0].trim()), base.resolve(parts[1].trim()),
+                    base.resolve(parts[2].trim())));
+        }
+        return cases;
+    }
+
+    /**
+     * Write one generated pair per size into dir; the expected mapping is the ground truth.
+     */
+    static List<Case> syntheticCases(Path dir, List<String> seedLines, int[] sizes) throws IOException {
+        List<Case> cases = new ArrayList<>();
+        for (int size : sizes) {
+            EditGenerator.Result pair = new EditGenerator().setLines(size).generate(seedLines, 42L + size);
+            Path[] written = pair.write(dir, "synthetic-" + size, "java");
+            cases.add(new Case("synthetic-" + size, written[0], written[1], written[2]));
+        }
+        return cases;
+    }
+
+    // ----- output -----
+
+    static void print(List<Result> results) {
+        Result total = new Result("TOTAL");
+        System.out.printf(Locale.ROOT, "%-60s %7s %9s %9s %9s %12s %7s%n",
+                "pair", "lines", "precision", "recall", "accuracy", "lines/s", "pruned");
+        for (Result r : results) {
+            printRow(r);
+            total.add(r);
+        }
+        printRow(total);
+    }
+
+    private static void printRow(Result r) {
+        String pruned = r.pairsScored + r.pairsPruned == 0 ? "-" : String.format(Locale.ROOT, "%.1f%%", 100 * r.pruneRate());
+        System.out.printf(Locale.ROOT, "%-60s %7d %9.3f %9.3f %9.3f %,12.0f %7s%n",
+                r.name, r.lines, r.precision(), r.recall(), r.accuracy(), r.linesPerSecond(), pruned);
+    }
+
+    static String toJson(List<Result> results) {
+        StringBuilder sb = new StringBuilder("{\"pairs\":[\n");
+        Result total = new Result("TOTAL");
+        for (int i = 0; i < results.size(); i++) {
+            sb.append("  ").append(rowJson(results.get(i))).append(i + 1 < results.size() ? ",\n" : "\n");
+            total.add(results.get(i));
+        }
+        return sb.append("],\n\"total\":").append(rowJson(total)).append("}\n").toString();
+    }
+
+    private static String rowJson(Result r) {
+        return String.format(Locale.ROOT,
+                "{\"name\":%s,\"lines\":%d,\"evaluated\":%d,\"precision\":%.4f,\"recall\":%.4f,"
+                        + "\"accuracy\":%.4f,\"mapMs\":%.3f,\"linesPerSecond\":%.1f,"
+                        + "\"pairsScored\":%d,\"pairsPruned\":%d,\"pruneRate\":%.4f}",
+                Json.quote(r.name), r.lines, r.evaluated, r.precision(), r.recall(), r.accuracy(),
+                r.mapMs, r.linesPerSecond(), r.pairsScored, r.pairsPruned, r.pruneRate());
+    }
+}
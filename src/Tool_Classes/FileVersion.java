@@ -2,20 +2,31 @@ package tool;
 
 
 import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
 
 /**
  * Wraps all the lines for one version of a file (old or new)
- * It just stores the file name and a list of LineRecord objects
+ * It just stores the file name, a list of LineRecord objects and the
+ * TokenDictionary their token ids come from
  */
 
 public class FileVersion {
 
     private final String fileName;
     private final List<LineRecord> lines;
+    private final TokenDictionary dictionary;
 
-    public FileVersion(String fileName, List<LineRecord> lines) {
+    // lazily built, read by many scoring threads, so no lock once they exist
+    private volatile int[][] tokenRows; // tokenRows[i] = token ids of line i+1
+    private volatile long[] contentSimHashes; // [i] = LineRecord.getContentSimHash of line i+1
+    private volatile long[] contextSimHashes;
+    private final Map<Integer, ContextTokens> contexts = new ConcurrentHashMap<>(); // context window -> sets
+
+    public FileVersion(String fileName, List<LineRecord> lines, TokenDictionary dictionary) {
         this.fileName = fileName;
         this.lines = lines;
+        this.dictionary = dictionary;
     }
 
     public String getFileName() {
@@ -25,4 +36,65 @@ public class FileVersion {
     public List<LineRecord> getLines() {
         return lines;
     }
+
+    public TokenDictionary getDictionary() {
+        return dictionary;
+    }
+
+    /**
+     * Token ids of every line as one array, indexed by lineNumber - 1.
+     */
+    public int[][] getTokenRows() {
+        int[][] rows = tokenRows;
+        if (rows == null) {
+            rows = new int[lines.size()][];
+            for (int i = 0; i < rows.length; i++) {
+                rows[i] = lines.get(i).getTokenIds();
+            }
+            tokenRows = rows; // a racing thread builds the same thing, harmless
+        }
+        return rows;
+    }
+
+    /**
+     * Content SimHash of every line in one contiguous array, indexed by lineNumber - 1,
+     * so the block kernels (SimHash.similarityBlock) do not chase LineRecords.
+     */
+    public long[] getContentSimHashes() {
+        long[] hashes = contentSimHashes;
+        if (hashes == null) {
+            hashes = new long[lines.size()];
+            for (int i = 0; i < hashes.length; i++) {
+                hashes[i] = lines.get(i).getContentSimHash();
+            }
+            contentSimHashes = hashes; // a racing thread builds the same thing, harmless
+        }
+        return hashes;
+    }
+
+    /**
+     * Context SimHash of every line, indexed by lineNumber - 1.
+     */
+    public long[] getContextSimHashes() {
+        long[] hashes = contextSimHashes;
+        if (hashes == null) {
+            hashes = new long[lines.size()];
+            for (int i = 0; i < hashes.length; i++) {
+                hashes[i] = lines.get(i).getContextSimHash();
+            }
+            contextSimHashes = hashes;
+        }
+        return hashes;
+    }
+
+    /**
+     * Context token sets for every line, built once per window size.
+     */
+    public ContextTokens getContextTokens(int window) {
+        ContextTokens context = contexts.get(window); // lock-free once built
+        if (context == null) {
+            context = contexts.computeIfAbsent(window, w -> ContextTokens.build(getTokenRows(), w));
+        }
+        return context;
+    }
 }
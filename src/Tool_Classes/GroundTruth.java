@@ -0,0 +1,156 @@
+package tool;
+
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
+
+/**
+ * Reads the hand-made expected mappings that come with the samples, in every format
+ * the team used, into one shape: old line -> expected new line (-1 = deleted).
+ *
+ *  - LHDiff XML        <LOCATION ORIG="12" NEW="14"/>, all VERSION blocks merged
+ *                      (a split NEW="14,15" counts as its first line)
+ *                      (line_mapping_nusrat, Line mapping Aarya Thapa)
+ *  - CSV               old,new,status; an empty old is an added line, an empty new a deleted one
+ *                      (line_mapping_zahra/map_*.csv)
+ *  - "a,b" / "a, b"    "_" or "__" for no line (Line_Mapping_Zahra_Elahi mapping.txt,
+ *                      line-mapping-tahrima "File-N Mapping.txt")
+ *  - "a b [status]"    our own output format (PROF_evaluation/*_map.txt), "a b,c" for a split
+ *
+ * Lines that are not a mapping (headers, titles, added lines) are skipped.
+ * Ground truth usually only covers part of a file, so only the listed old lines count.
+ */
+public final class GroundTruth {
+
+    private static final Pattern LOCATION =
+            Pattern.compile("<LOCATION\\s+ORIG\\s*=\\s*\"(-?\\d+)\"\\s+NEW\\s*=\\s*\"(-?\\d+)[\\d,\\s]*\"");
+    private static final Pattern FILE_ATTRIBUTE = Pattern.compile("<TEST[^>]*\\sFILE\\s*=\\s*\"([^\"]*)\"");
+
+    private GroundTruth() {
+    }
+
+    /**
+     * Expected mapping from a ground truth file of any supported format, in file order.
+     */
+    public static Map<Integer, Integer> read(Path file) throws IOException {
+        String text = new String(Files.readAllBytes(file), StandardCharsets.UTF_8);
+        Map<Integer, Integer> expected = new LinkedHashMap<>();
+
+        if (file.getFileName().toString().toLowerCase(Locale.ROOT).endsWith(".xml")) {
+            Matcher m = LOCATION.matcher(text);
+            while (m.find()) {
+                int oldLine = Integer.parseInt(m.group(1));
+                if (oldLine > 0) expected.putIfAbsent(oldLine, Math.max(-1, Integer.parseInt(m.group(2))));
+            }
+            return expected;
+        }
+
+        for (String line : text.split("\r\n|\r|\n")) {
+            String trimmed = line.trim();
+            String[] fields = trimmed.split("\\s*,\\s*|\\s+", -1); // "a,b", "a, b", "a b" and "a b,c"
+            if (fields.length < 2) {
+                continue;
+            }
+            int oldLine = parseLine(fields[0]);
+            if (oldLine <= 0) {
+                continue; // header, title or added line
+            }
+            expected.putIfAbsent(oldLine, parseLine(fields[1]));
+        }
+        return expected;
+    }
+
+    /**
+     * The ground truth file that belongs to a sample pair, or null if it has none.
+     * We look next to the old file (or next to its "...old" folder) and, if several
+     * files qualify, pick the one that names the pair: XML FILE attribute, then
+     * "map_<name>" against the file name, then the number in the name (file_3.xml, old3.java).
+     */
+    public static Path findFor(SamplePairs.Pair pair) throws IOException {
+        Path folder = pair.oldPath.toAbsolutePath().getParent();
+        if (folder.getFileName().toString().toLowerCase(Locale.ROOT).endsWith("old")) {
+            folder = folder.getParent(); // line-mapping-tahrima/file-N/file-old
+        }
+
+        List<Path> candidates;
+        try (Stream<Path> list = Files.list(folder)) {
+            candidates = list.filter(Files::isRegularFile).filter(GroundTruth::isTruthFile)
+                    .sorted().collect(Collectors.toList());
+        }
+        if (candidates.size() <= 1) {
+            return candidates.isEmpty() ? null : candidates.get(0);
+        }
+
+        String oldName = pair.oldPath.getFileName().toString();
+        String newName = pair.newPath.getFileName().toString();
+        for (Path candidate : candidates) {
+            String named = fileAttribute(candidate);
+            if (named != null && (named.equalsIgnoreCase(oldName) || named.equalsIgnoreCase(newName))) {
+                return candidate;
+            }
+        }
+
+        String pairStem = SamplePairs.stem(pair.oldPath);
+        for (Path candidate : candidates) {
+            String stem = SamplePairs.stem(candidate);
+            if (stem.startsWith("map") && stem.length() > 3 && pairStem.startsWith(stem.substring(3))) {
+                return candidate;
+            }
+        }
+
+        String pairNumber = digits(pairStem);
+        for (Path candidate : candidates) {
+            if (!pairNumber.isEmpty() && pairNumber.equals(digits(SamplePairs.stem(candidate)))) {
+                return candidate;
+            }
+        }
+        return null;
+    }
+
+    // ----- helpers -----
+
+    static boolean isTruthFile(Path file) {
+        String name = file.getFileName().toString().toLowerCase(Locale.ROOT);
+        return name.endsWith(".xml") || name.endsWith(".csv") || name.endsWith("mapping.txt")
+                || name.endsWith("_map.txt");
+    }
+
+    // "12" -> 12, "_" / "__" / "" / "-1" -> -1, anything else (a header word) -> 0
+    private static int parseLine(String field) {
+        String f = field.trim();
+        if (f.isEmpty() || f.chars().allMatch(c -> c == '_')) {
+            return -1;
+        }
+        try {
+            return Math.max(-1, Integer.parseInt(f));
+        } catch (NumberFormatException ex) {
+            return 0;
+        }
+    }
+
+    private static String fileAttribute(Path file) throws IOException {
+        if (!file.getFileName().toString().toLowerCase(Locale.ROOT).endsWith(".xml")) {
+            return null;
+        }
+        Matcher m = FILE_ATTRIBUTE.matcher(new String(Files.readAllBytes(file), StandardCharsets.UTF_8));
+        return m.find() && !m.group(1).isEmpty() ? m.group(1) : null;
+    }
+
+    private static String digits(String s) {
+        StringBuilder sb = new StringBuilder();
+        for (int i = 0; i < s.length(); i++) {
+            if (Character.isDigit(s.charAt(i))) sb.append(s.charAt(i));
+        }
+        return sb.toString();
+    }
+}
@@ -0,0 +1,253 @@
+package tool;
+
+
+import java.util.*;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.RecursiveTask;
+
+/**
+ * Steps 3 + 4 split into hunks.
+ *
+ * Once the unchanged lines are known, the remaining lines sit in gaps between them:
+ *
+ *     old:  A  x  y  B  z  C         anchors A, B, C are unchanged lines
+ *     new:  A  x' B  z' w  C
+ *
+ * Lines between anchors A and B on the old side can only reasonably match lines
+ * between A and B on the new side. So we:
+ *   - keep the longest chain of anchors that is in order on both sides,
+ *   - cut the file into hunks (the old and new unmatched lines between two anchors),
+ *   - generate candidates, score and greedily assign inside each hunk,
+ *     with hunks spread over a work-stealing ForkJoinPool,
+ *   - optionally run one more pass over whatever is left across all hunks, so lines
+ *     that moved to another hunk can still be found (cross-hunk move detection).
+ *
+ * Each task only touches the lines of its own hunks, which keeps the working set small.
+ */
+public class HunkMapper {
+
+    // a task maps its hunks itself once they hold at most this many old lines
+    private static final int LEAF_OLD_LINES = 256;
+
+    private final Mapper mapper;
+    private final CandidateSource candidateSource;  // used inside each hunk
+    private final CandidateSource crossHunkSource;  // used on the leftovers, null = no cross-hunk pass
+    private final int parallelism;
+
+    /**
+     * One gap between two anchors: the unmatched lines on each side.
+     */
+    static final class Hunk {
+        final Set<Integer> oldLines = new HashSet<>();
+        final Set<Integer> newLines = new HashSet<>();
+    }
+
+    public HunkMapper(Mapper mapper,
+                      CandidateSource candidateSource,
+                      CandidateSource crossHunkSource,
+                      int parallelism) {
+        this.mapper = mapper;
+        this.candidateSource = candidateSource;
+        this.crossHunkSource = crossHunkSource;
+        this.parallelism = parallelism;
+    }
+
+    /**
+     * Same result shape as Mapper.mapLines, but candidates are generated per hunk.
+     *
+     * @return list of MappingEntry (one per old line)
+     */
+    public List<MappingEntry> mapLines(FileVersion oldFile,
+                                       FileVersion newFile,
+                                       Map<Integer, Integer> unchangedMapping) {
+        int oldSize = oldFile.getLines().size();
+        int newSize = newFile.getLines().size();
+
+        Map<Integer, Integer> finalMapping = new HashMap<>(unchangedMapping);
+        Map<Integer, Double> bestScores = new HashMap<>();
+        for (int oldLine : unchangedMapping.keySet()) {
+            bestScores.put(oldLine, 1.0); // unchanged lines treated as perfect matches
+        }
+
+        PipelineMetrics metrics = mapper.getMetrics();
+        List<Hunk> hunks = partition(oldSize, newSize, unchangedMapping);
+        if (!hunks.isEmpty()) {
+            ForkJoinPool pool = new ForkJoinPool(parallelism);
+            try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.HUNKS)) {
+                HunkResult result = pool.invoke(new HunkTask(oldFile, newFile, hunks, 0, hunks.size()));
+                finalMapping.putAll(result.mapping);
+                bestScores.putAll(result.scores);
+            } finally {
+                pool.shutdown();
+            }
+        }
+
+        if (crossHunkSource != null) { // one global pass over what the hunks left behind
+            Set<Integer> mappedOldLines = new HashSet<>(finalMapping.keySet());
+            Set<Integer> usedNewLines = new HashSet<>(finalMapping.values());
+            Set<Integer> leftoverOld = new HashSet<>();
+            for (int i = 1; i <= oldSize; i++) {
+                if (!mappedOldLines.contains(i)) leftoverOld.add(i);
+            }
+            Set<Integer> leftoverNew = new HashSet<>();
+            for (int i = 1; i <= newSize; i++) {
+                if (!usedNewLines.contains(i)) leftoverNew.add(i);
+            }
+
+            if (!leftoverOld.isEmpty() && !leftoverNew.isEmpty()) {
+                Map<Integer, List<Integer>> candidates;
+                try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.CANDIDATES)) {
+                    candidates = crossHunkSource.generateCandidates(oldFile, newFile, leftoverOld, leftoverNew);
+                }
+                countCandidates(metrics, candidates);
+                List<Mapper.CandidateMatch> matches;
+                try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.SCORING)) {
+                    matches = mapper.scoreCandidates(oldFile, newFile, leftoverOld, candidates);
+                }
+                try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.ASSIGNMENT)) {
+                    mapper.assignMatches(matches, finalMapping, bestScores, mappedOldLines, usedNewLines);
+                }
+            }
+        }
+
+        return mapper.buildEntries(oldFile, newFile, unchangedMapping, finalMapping, bestScores);
+    }
+
+    /**
+     * Cut the files into hunks between anchors. Anchors that cross another anchor are
+     * dropped first (we keep the longest in-order chain), so the hunks never overlap.
+     * Hunks with no old line or no new line are skipped, there is nothing to match.
+     */
+    static List<Hunk> partition(int oldSize, int newSize, Map<Integer, Integer> unchangedMapping) {
+        int[][] chain = longestInOrderChain(unchangedMapping);
+
+        // hunk k sits between chain[k - 1] and chain[k]; hunk 0 starts at the file start,
+        // the last one ends at the file end
+        Hunk[] byGap = new Hunk[chain.length + 1];
+        for (int k = 0; k < byGap.length; k++) byGap[k] = new Hunk();
+
+        int gap = 0;
+        for (int oldLine = 1; oldLine <= oldSize; oldLine++) {
+            while (gap < chain.length && chain[gap][0] < oldLine) gap++;
+            if (!unchangedMapping.containsKey(oldLine)) byGap[gap].oldLines.add(oldLine);
+        }
+
+        Set<Integer> usedNew = new HashSet<>(unchangedMapping.values());
+        gap = 0;
+        for (int newLine = 1; newLine <= newSize; newLine++) {
+            while (gap < chain.length && chain[gap][1] < newLine) gap++;
+            if (!usedNew.contains(newLine)) byGap[gap].newLines.add(newLine);
+        }
+
+        List<Hunk> hunks = new ArrayList<>();
+        for (Hunk hunk : byGap) {
+            if (!hunk.oldLines.isEmpty() && !hunk.newLines.isEmpty()) hunks.add(hunk);
+        }
+        return hunks;
+    }
+
+    /**
+     * Add the size of every candidate list to the metrics (if any).
+     */
+    static void countCandidates(PipelineMetrics metrics, Map<Integer, List<Integer>> candidates) {
+        if (metrics == null) {
+            return;
+        }
+        long pairs = 0;
+        for (List<Integer> list : candidates.values()) pairs += list.size();
+        metrics.candidatesGenerated.add(pairs);
+    }
+
+    // ----- helpers -----
+
+    // anchors sorted by old line, reduced to the longest chain that also increases in new line
+    private static int[][] longestInOrderChain(Map<Integer, Integer> unchangedMapping) {
+        int[][] anchors = new int[unchangedMapping.size()][];
+        int a = 0;
+        for (Map.Entry<Integer, Integer> e : unchangedMapping.entrySet()) {
+            anchors[a++] = new int[]{e.getKey(), e.getValue()};
+        }
+        Arrays.sort(anchors, Comparator.comparingInt(x -> x[0]));
+
+        int n = anchors.length;
+        int[] tails = new int[n];    // index of the smallest tail for each chain length
+        int[] previous = new int[n];
+        int length = 0;
+        for (int i = 0; i < n; i++) {
+            int lo = 0;
+            int hi = length;
+            while (lo < hi) {
+                int mid = (lo + hi) >>> 1;
+                if (anchors[tails[mid]][1] < anchors[i][1]) lo = mid + 1;
+                else hi = mid;
+            }
+            previous[i] = lo > 0 ? tails[lo - 1] : -1;
+            tails[lo] = i;
+            if (lo == length) length++;
+        }
+
+        int[][] chain = new int[length][];
+        for (int i = length > 0 ? tails[length - 1] : -1, pos = length - 1; i != -1; i = previous[i], pos--) {
+            chain[pos] = anchors[i];
+        }
+        return chain;
+    }
+
+    private static final class HunkResult {
+        final Map<Integer, Integer> mapping = new HashMap<>();
+        final Map<Integer, Double> scores = new HashMap<>();
+    }
+
+    // maps hunks [from, to), splitting the range while it is big enough to share
+    private final class HunkTask extends RecursiveTask<HunkResult> {
+        private final FileVersion oldFile;
+        private final FileVersion newFile;
+        private final List<Hunk> hunks;
+        private final int from;
+        private final int to;
+
+        HunkTask(FileVersion oldFile, FileVersion newFile, List<Hunk> hunks, int from, int to) {
+            this.oldFile = oldFile;
+            this.newFile = newFile;
+            this.hunks = hunks;
+            this.from = from;
+            this.to = to;
+        }
+
+        @Override
+        protected HunkResult compute() {
+            int oldLines = 0;
+            for (int i = from; i < to; i++) oldLines += hunks.get(i).oldLines.size();
+
+            if (to - from == 1 || oldLines <= LEAF_OLD_LINES) {
+                PipelineMetrics metrics = mapper.getMetrics();
+                long allocatedBefore = metrics == null ? -1 : AllocationCounter.currentThreadAllocatedBytes();
+                HunkResult result = new HunkResult();
+                for (int i = from; i < to; i++) {
+                    mapHunk(hunks.get(i), result);
+                }
+                if (metrics != null) metrics.addAllocated(PipelineMetrics.Stage.HUNKS, allocatedBefore);
+                return result;
+            }
+
+            int mid = (from + to) >>> 1;
+            HunkTask left = new HunkTask(oldFile, newFile, hunks, from, mid);
+            left.fork();
+            HunkResult result = new HunkTask(oldFile, newFile, hunks, mid, to).compute();
+            HunkResult leftResult = left.join();
+            result.mapping.putAll(leftResult.mapping);
+            result.scores.putAll(leftResult.scores);
+            return result;
+        }
+
+        private void mapHunk(Hunk hunk, HunkResult result) {
+            Map<Integer, List<Integer>> candidates =
+                    candidateSource.generateCandidates(oldFile, newFile, hunk.oldLines, hunk.newLines);
+            countCandidates(mapper.getMetrics(), candidates);
+            List<Mapper.CandidateMatch> matches =
+                    mapper.scoreCandidates(oldFile, newFile, hunk.oldLines, candidates);
+            // hunks never share lines, so fresh used/mapped sets per hunk are enough
+            mapper.assignMatches(matches, result.mapping, result.scores, new HashSet<>(), new HashSet<>());
+        }
+    }
+}
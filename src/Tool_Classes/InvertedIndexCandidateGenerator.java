@@ -0,0 +1,136 @@
+package tool;
+
+
+import java.util.*;
+
+/**
+ * Step 3 (alternative): CANDIDATES FROM AN INVERTED TOKEN INDEX
+ *
+ * The window in CandidateGenerator misses lines that moved further than the window
+ * and tests every pair in it. Here we:
+ *   - build token -> unmatched new lines (postings) once, as one sorted array,
+ *   - for each unmatched old line walk the postings of its tokens and count how many
+ *     tokens each new line shares with it,
+ *   - skip very common tokens (like "return" or "i"), their postings are long and say little,
+ *   - keep the top-k new lines by shared-token count (closer line number wins ties).
+ *
+ * So move detection covers the whole file, and the cost is the total length of the
+ * postings we walk instead of old x new. Memory only depends on the lines passed in,
+ * so it is also cheap to run on one small hunk at a time (see HunkMapper).
+ */
+public class InvertedIndexCandidateGenerator implements CandidateSource {
+
+    private static final int MIN_TOKEN_FREQUENCY_LIMIT = 16; // never skip a token rarer than this
+
+    private final int topK;                // max candidates per old line
+    private final double maxTokenShare;    // skip tokens found in more than this share of unmatched new lines
+
+    public InvertedIndexCandidateGenerator(int topK, double maxTokenShare) {
+        this.topK = topK;
+        this.maxTokenShare = maxTokenShare;
+    }
+
+    @Override
+    public Map<Integer, List<Integer>> generateCandidates(FileVersion oldFile,
+                                                          FileVersion newFile,
+                                                          Set<Integer> unmatchedOldLines,
+                                                          Set<Integer> unmatchedNewLines) {
+        Map<Integer, List<Integer>> candidates = new HashMap<>();
+
+        int[] newLines = sorted(unmatchedNewLines); // local index -> line number
+
+        // postings as sorted (token << 32 | local index) keys: the new lines of token t are one
+        // contiguous run, and the size only depends on the lines we index (not the whole
+        // dictionary or file), so this stays cheap when called per hunk
+        int total = 0;
+        for (int newLine : newLines) {
+            total += getLine(newFile, newLine).getTokenIds().length;
+        }
+        long[] postings = new long[total];
+        int p = 0;
+        for (int local = 0; local < newLines.length; local++) {
+            for (int id : getLine(newFile, newLines[local]).getTokenIds()) {
+                postings[p++] = ((long) id << 32) | local;
+            }
+        }
+        Arrays.sort(postings);
+
+        int frequencyLimit = Math.max(MIN_TOKEN_FREQUENCY_LIMIT, (int) (maxTokenShare * newLines.length));
+
+        int[] shared = new int[newLines.length];  // shared-token count per local new line
+        int[] touched = new int[newLines.length]; // local new lines with shared > 0
+
+        for (int oldLine : sorted(unmatchedOldLines)) {
+            int touchedCount = 0;
+            for (int id : getLine(oldFile, oldLine).getTokenIds()) {
+                int from = firstAtLeast(postings, (long) id << 32);
+                int to = firstAtLeast(postings, (long) (id + 1) << 32);
+                if (to - from > frequencyLimit) continue; // too common to be useful
+                for (int k = from; k < to; k++) {
+                    int local = (int) postings[k]; // low 32 bits
+                    if (shared[local]++ == 0) {
+                        touched[touchedCount++] = local;
+                    }
+                }
+            }
+
+            candidates.put(oldLine, topCandidates(oldLine, shared, touched, touchedCount, newLines, topK));
+
+            for (int i = 0; i < touchedCount; i++) {
+                shared[touched[i]] = 0; // reset for the next old line
+            }
+        }
+
+        return candidates;
+    }
+
+    // ----- helpers -----
+
+    // best topK touched lines: highest count first, then nearest line number, then lower line number.
+    // counts and touched use local indexes, lineNumbers[local] is the real line number.
+    // (also used by MinHashCandidateGenerator, with band hits as the count)
+    static List<Integer> topCandidates(int oldLine, int[] counts, int[] touched, int touchedCount,
+                                       int[] lineNumbers, int topK) {
+        long[] keys = new long[touchedCount];
+        for (int i = 0; i < touchedCount; i++) {
+            int newLine = lineNumbers[touched[i]];
+            long distance = Math.abs((long) newLine - oldLine);
+            long side = newLine > oldLine ? 1 : 0;
+            keys[i] = ((long) (Integer.MAX_VALUE - counts[touched[i]]) << 32) | (distance << 1) | side;
+        }
+        Arrays.sort(keys);
+
+        int count = Math.min(topK, touchedCount);
+        List<Integer> result = new ArrayList<>(count);
+        for (int i = 0; i < count; i++) {
+            long low = keys[i] & 0xffffffffL;
+            int distance = (int) (low >>> 1);
+            result.add((low & 1) != 0 ? oldLine + distance : oldLine - distance);
+        }
+        return result;
+    }
+
+    // first index whose key is >= target (keys ascending)
+    private static int firstAtLeast(long[] keys, long target) {
+        int lo = 0;
+        int hi = keys.length;
+        while (lo < hi) {
+            int mid = (lo + hi) >>> 1;
+            if (keys[mid] < target) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    static int[] sorted(Set<Integer> lines) {
+        int[] result = new int[lines.size()];
+        int i = 0;
+        for (int line : lines) result[i++] = line;
+        Arrays.sort(result);
+        return result;
+    }
+
+    private LineRecord getLine(FileVersion file, int lineNumber) {
+        return file.getLines().get(lineNumber - 1);
+    }
+}
@@ -0,0 +1,135 @@
+package tool;
+
+
+import java.util.Arrays;
+
+/**
+ * Jaccard similarity on token ids without building any sets.
+ *
+ * Two representations:
+ *  - sorted, distinct int[] token ids (LineRecord.getTokenIds, ContextTokens): merge intersection
+ *  - packed long[] bitsets (bit i set = token id i present): AND/OR + popcount,
+ *    only worth it when the vocabulary is small, so each row is a few words
+ *
+ * Same conventions as the old HashSet version: two empty sets score 1.0.
+ */
+public final class JaccardKernel {
+
+    private JaccardKernel() {
+    }
+
+    /**
+     * |a ∩ b| for two ascending, duplicate-free arrays.
+     */
+    public static int intersectionSize(int[] a, int[] b) {
+        int i = 0;
+        int j = 0;
+        int common = 0;
+        while (i < a.length && j < b.length) {
+            int x = a[i];
+            int y = b[j];
+            if (x == y) {
+                common++;
+                i++;
+                j++;
+            } else if (x < y) {
+                i++;
+            } else {
+                j++;
+            }
+        }
+        return common;
+    }
+
+    public static double jaccard(int[] a, int[] b) {
+        if (a.length == 0 && b.length == 0) {
+            return 1.0;
+        }
+        int common = intersectionSize(a, b);
+        return (double) common / (a.length + b.length - common);
+    }
+
+    /**
+     * Jaccard of two bitsets; the shorter one is treated as zero-padded.
+     */
+    public static double jaccard(long[] a, long[] b) {
+        int common = 0;
+        int union = 0;
+        int shared = Math.min(a.length, b.length);
+        for (int w = 0; w < shared; w++) {
+            common += Long.bitCount(a[w] & b[w]);
+            union += Long.bitCount(a[w] | b[w]);
+        }
+        for (int w = shared; w < a.length; w++) union += Long.bitCount(a[w]);
+        for (int w = shared; w < b.length; w++) union += Long.bitCount(b[w]);
+        return union == 0 ? 1.0 : (double) common / union;
+    }
+
+    /**
+     * jaccard(a, rows[lines[k] - 1]) for k < count, into out[k]: one old line's bitset
+     * against a block of candidate rows. The AND/OR + popcount loop runs over the
+     * words both rows share, then the rest of the longer row, like jaccard(long[], long[]).
+     * Runs on BlockKernels.ACTIVE (Vector API when available).
+     *
+     * @param lines 1-based line numbers into rows
+     */
+    public static void jaccardBlock(long[] a, long[][] rows, int[] lines, int count, double[] out) {
+        BlockKernels.ACTIVE.jaccardBlock(a, rows, lines, count, out);
+    }
+
+    // the scalar jaccardBlock (BlockKernels.SCALAR)
+    static void jaccardBlockScalar(long[] a, long[][] rows, int[] lines, int count, double[] out) {
+        int ownBits = 0;
+        for (long word : a) ownBits += Long.bitCount(word);
+        for (int k = 0; k < count; k++) {
+            long[] b = rows[lines[k] - 1];
+            int shared = Math.min(a.length, b.length);
+            int common = 0;
+            int onlyB = 0; // bits of b outside a, so union = |a| + onlyB
+            for (int w = 0; w < shared; w++) {
+                common += Long.bitCount(a[w] & b[w]);
+                onlyB += Long.bitCount(b[w] & ~a[w]);
+            }
+            for (int w = shared; w < b.length; w++) onlyB += Long.bitCount(b[w]);
+            int union = ownBits + onlyB;
+            out[k] = union == 0 ? 1.0 : (double) common / union;
+        }
+    }
+
+    /**
+     * a ∪ b as a new ascending, duplicate-free array.
+     */
+    public static int[] union(int[] a, int[] b) {
+        int[] out = new int[a.length + b.length];
+        int i = 0;
+        int j = 0;
+        int n = 0;
+        while (i < a.length && j < b.length) {
+            if (a[i] == b[j]) {
+                out[n++] = a[i++];
+                j++;
+            } else if (a[i] < b[j]) {
+                out[n++] = a[i++];
+            } else {
+                out[n++] = b[j++];
+            }
+        }
+        while (i < a.length) out[n++] = a[i++];
+        while (j < b.length) out[n++] = b[j++];
+        return n == out.length ? out : Arrays.copyOf(out, n);
+    }
+
+    /**
+     * Packs sorted token ids into a bitset just long enough for the largest id.
+     */
+    public static long[] toBits(int[] tokenIds) {
+        if (tokenIds.length == 0) {
+            return new long[0];
+        }
+        long[] bits = new long[(tokenIds[tokenIds.length - 1] >>> 6) + 1];
+        for (int id : tokenIds) {
+            bits[id >>> 6] |= 1L << id; // shift uses the low 6 bits
+        }
+        return bits;
+    }
+}
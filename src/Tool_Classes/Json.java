@@ -0,0 +1,191 @@
+package tool;
+
+
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * Tiny JSON helper so the tool stays dependency free.
+ *
+ * parse() turns text into plain Java values:
+ *   object -> Map<String, Object> (keeps key order), array -> List<Object>,
+ *   string -> String, number -> Double, true/false -> Boolean, null -> null
+ * quote() escapes a string for writing JSON by hand.
+ */
+public final class Json {
+
+    private final String text;
+    private int pos;
+
+    private Json(String text) {
+        this.text = text;
+    }
+
+    /**
+     * Parse one JSON value; anything but whitespace after it is an error.
+     *
+     * @throws IllegalArgumentException on malformed input
+     */
+    public static Object parse(String text) {
+        Json parser = new Json(text);
+        Object value = parser.readValue();
+        parser.skipWhitespace();
+        if (parser.pos != text.length()) {
+            throw parser.error("unexpected trailing characters");
+        }
+        return value;
+    }
+
+    /**
+     * The string as a JSON string literal, quotes included.
+     */
+    public static String quote(String value) {
+        StringBuilder sb = new StringBuilder(value.length() + 2);
+        sb.append('"');
+        for (int i = 0; i < value.length(); i++) {
+            char c = value.charAt(i);
+            switch (c) {
+                case '"': sb.append("\\\""); break;
+                case '\\': sb.append("\\\\"); break;
+                case '\n': sb.append("\\n"); break;
+                case '\r': sb.append("\\r"); break;
+                case '\t': sb.append("\\t"); break;
+                default:
+                    if (c < 0x20) {
+                        sb.append(String.format("\\u%04x", (int) c));
+                    } else {
+                        sb.append(c);
+                    }
+            }
+        }
+        return sb.append('"').toString();
+    }
+
+    // ----- helpers -----
+
+    private Object readValue() {
+        skipWhitespace();
+        if (pos >= text.length()) throw error("unexpected end of input");
+        char c = text.charAt(pos);
+        switch (c) {
+            case '{': return readObject();
+            case '[': return readArray();
+            case '"': return readString();
+            case 't': expect("true"); return Boolean.TRUE;
+            case 'f': expect("false"); return Boolean.FALSE;
+            case 'n': expect("null"); return null;
+            default:
+                if (c == '-' || (c >= '0' && c <= '9')) return readNumber();
+                throw error("unexpected character '" + c + "'");
+        }
+    }
+
+    private Map<String, Object> readObject() {
+        Map<String, Object> map = new LinkedHashMap<>();
+        pos++; // {
+        skipWhitespace();
+        if (peek() == '}') {
+            pos++;
+            return map;
+        }
+        while (true) {
+            skipWhitespace();
+            if (peek() != '"') throw error("expected a key");
+            String key = readString();
+            skipWhitespace();
+            if (peek() != ':') throw error("expected ':'");
+            pos++;
+            map.put(key, readValue());
+            skipWhitespace();
+            char c = peek();
+            pos++;
+            if (c == '}') return map;
+            if (c != ',') throw error("expected ',' or '}'");
+        }
+    }
+
+    private List<Object> readArray() {
+        List<Object> list = new ArrayList<>();
+        pos++; // [
+        skipWhitespace();
+        if (peek() == ']') {
+            pos++;
+            return list;
+        }
+        while (true) {
+            list.add(readValue());
+            skipWhitespace();
+            char c = peek();
+            pos++;
+            if (c == ']') return list;
+            if (c != ',') throw error("expected ',' or ']'");
+        }
+    }
+
+    private String readString() {
+        StringBuilder sb = new StringBuilder();
+        pos++; // opening quote
+        while (true) {
+            if (pos >= text.length()) throw error("unterminated string");
+            char c = text.charAt(pos++);
+            if (c == '"') return sb.toString();
+            if (c != '\\') {
+                sb.append(c);
+                continue;
+            }
+            if (pos >= text.length()) throw error("unterminated escape");
+            char e = text.charAt(pos++);
+            switch (e) {
+                case '"': sb.append('"'); break;
+                case '\\': sb.append('\\'); break;
+                case '/': sb.append('/'); break;
+                case 'b': sb.append('\b'); break;
+                case 'f': sb.append('\f'); break;
+                case 'n': sb.append('\n'); break;
+                case 'r': sb.append('\r'); break;
+                case 't': sb.append('\t'); break;
+                case 'u':
+                    if (pos + 4 > text.length()) throw error("bad \\u escape");
+                    sb.append((char) Integer.parseInt(text.substring(pos, pos + 4), 16));
+                    pos += 4;
+                    break;
+                default:
+                    throw error("bad escape '\\" + e + "'");
+            }
+        }
+    }
+
+    private Double readNumber() {
+        int start = pos;
+        while (pos < text.length() && "+-0123456789.eE".indexOf(text.charAt(pos)) >= 0) {
+            pos++;
+        }
+        try {
+            return Double.parseDouble(text.substring(start, pos));
+        } catch (NumberFormatException ex) {
+            throw error("bad number");
+        }
+    }
+
+    private void expect(String word) {
+        if (!text.startsWith(word, pos)) throw error("expected " + word);
+        pos += word.length();
+    }
+
+    private char peek() {
+        if (pos >= text.length()) throw error("unexpected end of input");
+        return text.charAt(pos);
+    }
+
+    private void skipWhitespace() {
+        while (pos < text.length() && Character.isWhitespace(text.charAt(pos))) {
+            pos++;
+        }
+    }
+
+    private IllegalArgumentException error(String message) {
+        return new IllegalArgumentException("JSON: " + message + " at position " + pos);
+    }
+}
@@ -0,0 +1,47 @@
+package tool;
+
+
+import java.io.BufferedWriter;
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.Locale;
+
+/**
+ * JSON Lines, one object per old line, with what the text format leaves out:
+ *
+ *   {"orig":1,"new":1,"status":"unchanged","score":1.0}
+ *   {"orig":2,"new":4,"status":"modified","score":0.7132}
+ *   {"orig":3,"new":-1,"status":"deleted","score":0.0}
+ *   {"orig":4,"new":5,"newEnd":6,"status":"modified","score":0.8125}
+ *
+ * newEnd is only there for a line split over new..newEnd.
+ *
+ * score is null when the mapping did not come with one (e.g. composed chain mappings).
+ */
+public class JsonLinesMappingFormat implements MappingFormat {
+
+    @Override
+    public void write(MappingTable table, Path out) throws IOException {
+        try (BufferedWriter writer = Files.newBufferedWriter(out)) {
+            for (int oldLine = 1; oldLine <= table.size(); oldLine++) {
+                if (!table.has(oldLine)) continue;
+                float score = table.getScore(oldLine);
+                writer.write("{\"orig\":");
+                writer.write(Integer.toString(oldLine));
+                writer.write(",\"new\":");
+                writer.write(Integer.toString(table.getNewLine(oldLine)));
+                if (table.isSplit(oldLine)) {
+                    writer.write(",\"newEnd\":");
+                    writer.write(Integer.toString(table.getNewLineEnd(oldLine)));
+                }
+                writer.write(",\"status\":\"");
+                writer.write(table.getStatus(oldLine)); // fixed names, nothing to escape
+                writer.write("\",\"score\":");
+                writer.write(Float.isNaN(score) ? "null" : String.format(Locale.ROOT, "%.4f", score));
+                writer.write('}');
+                writer.newLine();
+            }
+        }
+    }
+}
@@ -2,21 +2,31 @@ package tool;
 
 
 import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
 import java.util.*;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
 
 /**
  * LineMappingTool
  *
  * Main class that:
  *  Step 1: uses Preprocessor to load + normalize files
- *  Step 2: uses UnchangedDetector to find exact matches
+ *  Step 2: uses UnchangedDetector (or DiffAnchorDetector) to find exact matches
  *  Step 3: uses CandidateGenerator to generate candidate new lines
  *  Step 4+5: uses Mapper + SimilarityCalculator to compute final mappings
- *  Step 6: uses MappingWriter to write the TXT mapping file
+ *  (with --hunks, Steps 3-4 run per gap between unchanged lines, see HunkMapper)
+ *  Step 6: uses MappingWriter to write the mapping file (TXT by default, see --format)
  */
 public class LineMappingTool {
 
-    
+    public static final int CONTEXT_WINDOW = 2;            // context lines above/below, for fingerprints and scoring
+    public static final double SIMILARITY_THRESHOLD = 0.6; // minimum combined score to accept a match
+
+    // counters of the last map() call, for --stats (so one tool object per thread)
+    private double lastMinHashRecall = -1; // MINHASH + --stats: recall against the exhaustive window
+
     public LineMappingTool() {
     }
 
@@ -24,73 +34,233 @@ public class LineMappingTool {
      * High-level pipeline.
      */
     public void run(String oldFilePath, String newFilePath, String outputMappingPath) throws IOException { // to run the tool
+        run(oldFilePath, newFilePath, outputMappingPath, new MappingOptions());
+    }
+
+    /**
+     * High-level pipeline with explicit options (anchor mode etc.).
+     */
+    public void run(String oldFilePath, String newFilePath, String outputMappingPath,
+                    MappingOptions options) throws IOException {
+        long allocatedBefore = AllocationCounter.currentThreadAllocatedBytes();
+        PipelineMetrics metrics = PipelineMetrics.forRun(options); // null unless --stats, --report or JFR
+
         // Step 1: read + normalize
-        Preprocessor preprocessor = new Preprocessor(); // we preprocess files
-        FileVersion oldFile = preprocessor.loadFile(oldFilePath); // we load old file
-        FileVersion newFile = preprocessor.loadFile(newFilePath); // we load new file
+        Preprocessor preprocessor = newPreprocessor(options); // we preprocess files
+        FileVersion oldFile;
+        FileVersion newFile;
+        try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.PREPROCESS)) {
+            oldFile = preprocessor.loadFile(oldFilePath); // we load old file
+            newFile = preprocessor.loadFile(newFilePath); // we load new file
+        }
 
-        UnchangedDetector unchangedDetector = new UnchangedDetector(); // Step 2: detect unchanged lines
-        Map<Integer, Integer> unchangedMapping = unchangedDetector.detectUnchanged(oldFile, newFile);
-        // unchangedMapping: oldLine -> newLine
+        // Steps 2-5
+        List<MappingEntry> finalMappings = map(oldFile, newFile, options, metrics);
 
-        
-        Set<Integer> unmatchedOld = new HashSet<>(); // we store unmatched old lines
-        for (LineRecord lr : oldFile.getLines()) {
-            if (!unchangedMapping.containsKey(lr.getLineNumber())) { // to find unmatched old lines
-                unmatchedOld.add(lr.getLineNumber());
+        // Step 6: write the mapping (--format)
+        try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.WRITE)) {
+            MappingWriter mappingWriter = new MappingWriter(MappingFormat.of(options.getOutputFormat()));
+            mappingWriter.writeMapping(outputMappingPath, finalMappings);
+        }
+
+        if (metrics != null) {
+            metrics.finish(oldFile, newFile);
+            if (options.getReportFile() != null) {
+                Files.writeString(Path.of(options.getReportFile()), metrics.toJson(oldFile, newFile));
             }
         }
 
-        Set<Integer> usedNew = new HashSet<>(unchangedMapping.values()); // we store used new lines
-        Set<Integer> unmatchedNew = new HashSet<>();
-        for (LineRecord lr : newFile.getLines()) {
-            if (!usedNew.contains(lr.getLineNumber())) {
-                unmatchedNew.add(lr.getLineNumber());
+        if (options.isPrintStats()) {
+            long allocated = AllocationCounter.currentThreadAllocatedBytes() - allocatedBefore;
+            System.err.println("old lines: " + oldFile.getLines().size()
+                    + ", new lines: " + newFile.getLines().size());
+            System.err.println("distinct tokens: " + preprocessor.getDictionary().size()
+                    + ", token occurrences: " + preprocessor.getTokenOccurrences());
+            metrics.print(System.err);
+            if (lastMinHashRecall >= 0) {
+                System.err.println("minhash recall vs window: " + lastMinHashRecall);
             }
+            System.err.println("allocated bytes: " + (allocatedBefore < 0 ? "n/a" : allocated));
         }
+    }
 
+    /**
+     * Steps 2-5 on two files that were already loaded by the same Preprocessor
+     * (built with CONTEXT_WINDOW, so the token ids and fingerprints line up).
+     * Used by run, BatchMappingTool, MappingServer and ChainMappingTool.
+     *
+     * @return one MappingEntry per old line
+     */
+    public List<MappingEntry> map(FileVersion oldFile, FileVersion newFile, MappingOptions options) {
+        return map(oldFile, newFile, options, null);
+    }
 
-        CandidateGenerator candidateGenerator = new CandidateGenerator( // Step 3: generate candidates
-                15,   // window size (tweak if needed)
-                true  // require token overlap
-        );
-        Map<Integer, List<Integer>> candidates =
-                candidateGenerator.generateCandidates(oldFile, newFile, unmatchedOld, unmatchedNew); // we generate candidates
+    /**
+     * Same as map(oldFile, newFile, options), timing the stages and counting into metrics
+     * (null = not measured).
+     */
+    public List<MappingEntry> map(FileVersion oldFile, FileVersion newFile, MappingOptions options,
+                                  PipelineMetrics metrics) {
+        // Step 2: detect unchanged lines
+        Map<Integer, Integer> unchangedMapping;
+        try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.UNCHANGED)) {
+            if (options.getAnchorMode() == MappingOptions.AnchorMode.DIFF) {
+                DiffAnchorDetector detector = new DiffAnchorDetector();
+                unchangedMapping = detector.detectUnchanged(oldFile, newFile);
+                if (metrics != null) metrics.exactMatches.add(detector.getMatchedCount());
+            } else {
+                UnchangedDetector detector = new UnchangedDetector();
+                unchangedMapping = detector.detectUnchanged(oldFile, newFile);
+                if (metrics != null) {
+                    metrics.exactMatches.add(detector.getMatchedCount());
+                    metrics.hashCollisions.add(detector.getCollisionCount());
+                }
+            }
+        }
+        // unchangedMapping: oldLine -> newLine
 
-        // Step 4: similarity + mapping
+        // Step 3 + 4 setup
+        CandidateSource candidateGenerator = candidateSource(options);
         SimilarityCalculator similarityCalculator = new SimilarityCalculator( // we set up similarity calculator
-                2    // context window size (lines above/below)
+                CONTEXT_WINDOW,    // context window size (lines above/below)
+                options.getSimilarityMode(),
+                SIMILARITY_THRESHOLD,
+                options.getSimHashFallbackBand()
         );
+        // parallel scoring inside Mapper (hunk mode is already parallel per hunk)
+        ExecutorService scoringPool = null;
+        if (options.isParallelScoring() && !options.isHunkMode() && options.getThreads() > 1) {
+            scoringPool = Executors.newFixedThreadPool(options.getThreads());
+        }
         Mapper mapper = new Mapper( // to map lines
                 similarityCalculator,
-                0.6,  // similarity threshold
+                SIMILARITY_THRESHOLD,  // similarity threshold
                 true, // enableSplitRefinement 
-                3    // maxSplitLength (used only if enableSplitRefinement=true)
+                3,    // maxSplitLength (used only if enableSplitRefinement=true)
+                scoringPool,
+                metrics
         );
 
-        List<MappingEntry> finalMappings =
-                mapper.mapLines(oldFile, newFile, unchangedMapping, candidates);
+        List<MappingEntry> finalMappings;
+        lastMinHashRecall = -1;
 
-        // Step 6: write TXT mapping
-        MappingWriter mappingWriter = new MappingWriter();
-        mappingWriter.writeMapping(outputMappingPath, finalMappings);
+        try {
+            if (options.isHunkMode()) {
+                // Step 3 + 4 per hunk between unchanged lines, in parallel
+                CandidateSource crossHunkSource = null;
+                if (options.isCrossHunkMoves()) {
+                    crossHunkSource = new InvertedIndexCandidateGenerator(
+                            options.getCandidateTopK(), options.getMaxTokenShare());
+                }
+                HunkMapper hunkMapper = new HunkMapper(mapper, candidateGenerator, crossHunkSource, options.getThreads());
+                finalMappings = hunkMapper.mapLines(oldFile, newFile, unchangedMapping);
+            } else {
+                Set<Integer> unmatchedOld = new HashSet<>(); // we store unmatched old lines
+                for (LineRecord lr : oldFile.getLines()) {
+                    if (!unchangedMapping.containsKey(lr.getLineNumber())) { // to find unmatched old lines
+                        unmatchedOld.add(lr.getLineNumber());
+                    }
+                }
+
+                Set<Integer> usedNew = new HashSet<>(unchangedMapping.values()); // we store used new lines
+                Set<Integer> unmatchedNew = new HashSet<>();
+                for (LineRecord lr : newFile.getLines()) {
+                    if (!usedNew.contains(lr.getLineNumber())) {
+                        unmatchedNew.add(lr.getLineNumber());
+                    }
+                }
+
+                // Step 3: generate candidates
+                Map<Integer, List<Integer>> candidates;
+                try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.CANDIDATES)) {
+                    candidates = candidateGenerator.generateCandidates(oldFile, newFile, unmatchedOld, unmatchedNew); // we generate candidates
+                }
+                HunkMapper.countCandidates(metrics, candidates);
+
+                if (options.isPrintStats() && options.getCandidateMode() == MappingOptions.CandidateMode.MINHASH) {
+                    Map<Integer, List<Integer>> windowCandidates =
+                            windowCandidateGenerator().generateCandidates(oldFile, newFile, unmatchedOld, unmatchedNew);
+                    lastMinHashRecall = MinHashCandidateGenerator.measureRecall(candidates, windowCandidates);
+                }
+
+                // Step 4: similarity + mapping
+                finalMappings = mapper.mapLines(oldFile, newFile, unchangedMapping, candidates);
+            }
+        } finally {
+            if (scoringPool != null) {
+                scoringPool.shutdown();
+            }
+        }
+
+        return finalMappings;
+    }
+
+    /**
+     * Step 1 set up the way the options ask (comment stripping, cache folder).
+     * Files that will be mapped against each other must come from the same Preprocessor.
+     */
+    public static Preprocessor newPreprocessor(MappingOptions options) throws IOException {
+        PreprocessCache cache = options.getCacheDir() == null ? null
+                : new PreprocessCache(Path.of(options.getCacheDir()));
+        return new Preprocessor(CONTEXT_WINDOW, options.isStripComments(), cache);
+    }
+
+    private static CandidateSource candidateSource(MappingOptions options) {
+        if (options.getCandidateMode() == MappingOptions.CandidateMode.INDEX) {
+            return new InvertedIndexCandidateGenerator(
+                    options.getCandidateTopK(),  // candidates per old line
+                    options.getMaxTokenShare()   // skip very common tokens
+            );
+        }
+        if (options.getCandidateMode() == MappingOptions.CandidateMode.MINHASH) {
+            return new MinHashCandidateGenerator(
+                    options.getLshBands(),
+                    options.getLshRows(),
+                    options.getCandidateTopK(),
+                    1000  // skip buckets bigger than this
+            );
+        }
+        return windowCandidateGenerator();
+    }
+
+    static CandidateGenerator windowCandidateGenerator() {
+        return new CandidateGenerator(
+                15,   // window size (tweak if needed)
+                true  // require token overlap
+        );
     }
 
     /**
-     * Simple CLI: java Tool_Classes.LineMappingTool old.java new.java mapping.txt
+     * Simple CLI: java Tool_Classes.LineMappingTool [options] old.java new.java mapping.txt
+     * (options are listed in MappingOptions.USAGE)
      */
     public static void main(String[] args) throws IOException { // main method to run the tool
-        if (args.length < 3) {
-           System.err.println("Usage: java tool.LineMappingTool <oldFile> <newFile> <outputMappingFile>");
+        MappingOptions options = new MappingOptions();
+        List<String> files = new ArrayList<>();
+        for (String arg : args) {
+            if (arg.startsWith("--")) {
+                if (!options.applyFlag(arg)) {
+                    System.err.println("Unknown option or bad value: " + arg);
+                    System.err.println(MappingOptions.USAGE);
+                    System.exit(1);
+                }
+            } else {
+                files.add(arg);
+            }
+        }
+
+        if (files.size() < 3) {
+           System.err.println("Usage: java tool.LineMappingTool [options] <oldFile> <newFile> <outputMappingFile>");
+           System.err.println(MappingOptions.USAGE);
             System.exit(1);
         }
 
-        String oldFile = args[0];
-        String newFile = args[1];
-        String outFile = args[2];
+        String oldFile = files.get(0);
+        String newFile = files.get(1);
+        String outFile = files.get(2);
 
         LineMappingTool tool = new LineMappingTool();
-        tool.run(oldFile, newFile, outFile);
+        tool.run(oldFile, newFile, outFile, options);
     }
 }
 
@@ -6,32 +6,103 @@ package tool;
  * Represents a single line in a file
  * We store:
     * The line number in the file (1-based)
-    * The original text
-    * The normalized text (used for matching)
+    * The original text (or where to find it in the mapped file, see MappedLines)
+    * The normalized text (used for matching, built on first use for mapped lines)
+    * The token ids of the normalized text (sorted, no duplicates)
+    * The line id of the normalized text (TokenDictionary.internLine), for exact matching
+    * SimHash fingerprints of the line and of its context window
  */
 
 public class LineRecord {
 
     private final int lineNumber;
-    private final String originalText;
-    private final String normalizedText;
+    private final String originalText;   // null when the line lives in a MappedLines
+    private final MappedLines source;
+    private String normalizedText;       // lazy for mapped lines; racing threads compute the same String
+    private final int[] tokenIds;
+    private final int lineId;            // equal normalized text -> equal id (same dictionary)
+    private final long contentSimHash;
+    private final long contextSimHash;
 
-    public LineRecord(int lineNumber, String originalText, String normalizedText) {
+    public LineRecord(int lineNumber, String originalText, String normalizedText, int[] tokenIds, int lineId,
+                      long contentSimHash, long contextSimHash) {
         this.lineNumber = lineNumber;
         this.originalText = originalText;
+        this.source = null;
         this.normalizedText = normalizedText;
+        this.tokenIds = tokenIds;
+        this.lineId = lineId;
+        this.contentSimHash = contentSimHash;
+        this.contextSimHash = contextSimHash;
+    }
+
+    /**
+     * A line of a memory-mapped file: its text is decoded from source only when asked for.
+     */
+    public LineRecord(int lineNumber, MappedLines source, int[] tokenIds, int lineId,
+                      long contentSimHash, long contextSimHash) {
+        this.lineNumber = lineNumber;
+        this.originalText = null;
+        this.source = source;
+        this.tokenIds = tokenIds;
+        this.lineId = lineId;
+        this.contentSimHash = contentSimHash;
+        this.contextSimHash = contextSimHash;
     }
 
     public int getLineNumber() {
         return lineNumber;
     }
 
+    /**
+     * For mapped lines this decodes a new String on every call, keep it if you need it twice.
+     */
     public String getOriginalText() {
-        return originalText;
+        return originalText != null ? originalText : source.getLine(lineNumber - 1);
     }
 
     public String getNormalizedText() {
-        return normalizedText;
+        String normalized = normalizedText;
+        if (normalized == null) {
+            normalized = source.getNormalizedLine(lineNumber - 1);
+            normalizedText = normalized;
+        }
+        return normalized;
+    }
+
+    /**
+     * Normalized text without keeping it: for mapped lines this normalizes again on
+     * every call. For the rare comparisons that cannot go by line id.
+     */
+    public String getNormalizedTextUncached() {
+        String normalized = normalizedText;
+        return normalized != null ? normalized : source.getNormalizedLine(lineNumber - 1);
+    }
+
+    /**
+     * Id of the normalized text in the file's TokenDictionary (internLine). Lines with
+     * equal ids have equal text unless the dictionary marks the id ambiguous.
+     */
+    public int getLineId() {
+        return lineId;
+    }
+
+    /**
+     * Ids from the TokenDictionary of this file, ascending and distinct.
+     * Shared array, do not modify.
+     */
+    public int[] getTokenIds() {
+        return tokenIds;
     }
-}
 
+    public long getContentSimHash() {
+        return contentSimHash;
+    }
+
+    /**
+     * SimHash of the tokens of the surrounding lines (window chosen by the Preprocessor).
+     */
+    public long getContextSimHash() {
+        return contextSimHash;
+    }
+}
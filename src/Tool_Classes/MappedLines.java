@@ -0,0 +1,223 @@
+package tool;
+
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.util.Arrays;
+
+/**
+ * A text file memory-mapped through FileChannel, plus where each line starts and ends.
+ *
+ * Nothing is decoded up front: the Preprocessor tokenizes straight from the bytes and
+ * a line's String is only built when someone asks for it (LineRecord.getOriginalText).
+ * Lines are split like Files.readAllLines / BufferedReader.readLine: "\n", "\r" and "\r\n"
+ * all end a line, and a terminator at the very end does not add an empty last line.
+ * Text is UTF-8. Bad bytes decode as U+FFFD instead of failing the whole file like
+ * Files.readAllLines did, so the Preprocessor checks malformedOffset first and warns.
+ */
+public final class MappedLines {
+
+    private static final ByteBuffer EMPTY = ByteBuffer.allocate(0);
+
+    private final ByteBuffer bytes;   // never moved: every read uses absolute get or a duplicate
+    private final int[] lineStarts;   // byte offset of the first byte of line i+1
+    private final int[] lineEnds;     // byte offset just past its last byte (terminator excluded)
+    private final int lineCount;
+
+    // how the Preprocessor normalized this file, so a line can be normalized again on its own
+    private Normalizer.Profile profile = Normalizer.Profile.PLAIN;
+    private byte[] startStates;       // Normalizer state at the start of each line, null = all CODE
+
+    private MappedLines(ByteBuffer bytes, int[] lineStarts, int[] lineEnds, int lineCount) {
+        this.bytes = bytes;
+        this.lineStarts = lineStarts;
+        this.lineEnds = lineEnds;
+        this.lineCount = lineCount;
+    }
+
+    /**
+     * Map the file read-only and find the line boundaries (one pass over the bytes).
+     * The mapping stays valid after the channel is closed.
+     */
+    public static MappedLines map(Path path) throws IOException {
+        return split(mapFile(path));
+    }
+
+    /**
+     * Map the whole file read-only (an empty buffer for an empty file).
+     */
+    static ByteBuffer mapFile(Path path) throws IOException {
+        try (FileChannel channel = FileChannel.open(path, StandardOpenOption.READ)) {
+            long size = channel.size();
+            if (size > Integer.MAX_VALUE) {
+                throw new IOException("File too large to map (" + size + " bytes): " + path);
+            }
+            return size == 0 ? EMPTY : channel.map(FileChannel.MapMode.READ_ONLY, 0, size);
+        }
+    }
+
+    /**
+     * Lines of already mapped bytes whose boundaries are known (PreprocessCache).
+     */
+    static MappedLines withOffsets(ByteBuffer bytes, int[] lineStarts, int[] lineEnds) {
+        return new MappedLines(bytes, lineStarts, lineEnds, lineStarts.length);
+    }
+
+    // finds the line boundaries, the way BufferedReader.readLine does
+    static MappedLines split(ByteBuffer bytes) {
+        int size = bytes.limit();
+        int[] starts = new int[Math.max(16, size / 32)]; // ~32 bytes per line is a fair first guess
+        int[] ends = new int[starts.length];
+        int count = 0;
+
+        int start = 0;
+        int pos = 0;
+        while (pos < size) {
+            byte b = bytes.get(pos);
+            if (b == '\n' || b == '\r') {
+                if (count == starts.length) {
+                    starts = Arrays.copyOf(starts, count * 2);
+                    ends = Arrays.copyOf(ends, count * 2);
+                }
+                starts[count] = start;
+                ends[count] = pos;
+                count++;
+                pos++;
+                if (b == '\r' && pos < size && bytes.get(pos) == '\n') pos++; // \r\n is one terminator
+                start = pos;
+            } else {
+                pos++;
+            }
+        }
+        if (start < size) { // last line without a terminator
+            if (count == starts.length) {
+                starts = Arrays.copyOf(starts, count + 1);
+                ends = Arrays.copyOf(ends, count + 1);
+            }
+            starts[count] = start;
+            ends[count] = size;
+            count++;
+        }
+        return new MappedLines(bytes, starts, ends, count);
+    }
+
+    public int size() {
+        return lineCount;
+    }
+
+    /**
+     * Byte offset of the first byte that is not valid UTF-8 (bad lead or continuation
+     * byte, truncated, overlong, surrogate or above U+10FFFF), or -1 if all of it is valid.
+     * No decoding: a straight pass over the bytes, ASCII costs one compare per byte.
+     */
+    static int malformedOffset(ByteBuffer bytes) {
+        int size = bytes.limit();
+        int pos = 0;
+        while (pos < size) {
+            int b = bytes.get(pos) & 0xFF;
+            if (b < 0x80) {
+                pos++;
+                continue;
+            }
+            int extra;
+            int min;     // smallest code point for this length (shorter = overlong)
+            int cp;
+            if (b >= 0xC2 && b <= 0xDF) {
+                extra = 1; min = 0x80; cp = b & 0x1F;
+            } else if (b >= 0xE0 && b <= 0xEF) {
+                extra = 2; min = 0x800; cp = b & 0x0F;
+            } else if (b >= 0xF0 && b <= 0xF4) {
+                extra = 3; min = 0x10000; cp = b & 0x07;
+            } else {
+                return pos; // continuation byte without a lead, or C0/C1/F5..FF
+            }
+            if (pos + extra >= size) {
+                return pos; // truncated at the end of the file
+            }
+            for (int k = 1; k <= extra; k++) {
+                int c = bytes.get(pos + k) & 0xFF;
+                if ((c & 0xC0) != 0x80) return pos;
+                cp = (cp << 6) | (c & 0x3F);
+            }
+            if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+                return pos;
+            }
+            pos += extra + 1;
+        }
+        return -1;
+    }
+
+    /**
+     * 1-based line number of a byte offset, split the same way as split() does.
+     */
+    static int lineOf(ByteBuffer bytes, int offset) {
+        int line = 1;
+        for (int pos = 0; pos < offset; pos++) {
+            byte b = bytes.get(pos);
+            if (b == '\n' || (b == '\r' && (pos + 1 >= bytes.limit() || bytes.get(pos + 1) != '\n'))) {
+                line++; // \r\n counts once, at its \n
+            }
+        }
+        return line;
+    }
+
+    /**
+     * First byte of line index (0-based).
+     */
+    public int lineStart(int index) {
+        return lineStarts[index];
+    }
+
+    /**
+     * One past the last byte of line index (0-based), terminator excluded.
+     */
+    public int lineEnd(int index) {
+        return lineEnds[index];
+    }
+
+    public byte byteAt(int offset) {
+        return bytes.get(offset);
+    }
+
+    /**
+     * Remember the profile and the per-line start states the file was normalized with.
+     */
+    void setNormalization(Normalizer.Profile profile, byte[] startStates) {
+        this.profile = profile;
+        this.startStates = startStates;
+    }
+
+    byte getStartState(int index) {
+        return startStates == null ? Normalizer.CODE : startStates[index];
+    }
+
+    /**
+     * The mapped bytes (shared, read with absolute gets only).
+     */
+    ByteBuffer getBytes() {
+        return bytes;
+    }
+
+    /**
+     * Normalized text of line index (0-based), the same as the Preprocessor saw it.
+     */
+    public String getNormalizedLine(int index) {
+        return Normalizer.normalizeLine(profile, getStartState(index), getLine(index));
+    }
+
+    /**
+     * Decode line index (0-based) into a new String. Safe to call from any thread.
+     */
+    public String getLine(int index) {
+        int start = lineStarts[index];
+        byte[] raw = new byte[lineEnds[index] - start];
+        ByteBuffer view = bytes.duplicate(); // own position, so callers don't race
+        view.position(start);
+        view.get(raw);
+        return new String(raw, StandardCharsets.UTF_8);
+    }
+}
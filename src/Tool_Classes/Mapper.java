@@ -2,12 +2,20 @@ package tool;
 
 
 import java.util.*;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Future;
 
 /**
  * Step 4 
  *  - Choosing best matches for unmatched old lines based on combined similarity.
  *  - If score >= threshold, accept; otherwise we will mark as deleted.
  *  - Produce final List<MappingEntry> for all old lines.
+ *
+ * Scoring can be spread over a thread pool. The old lines are cut into fixed chunks,
+ * each chunk is scored into its own buffer, and the buffers are joined in chunk
+ * order, so the match list (and therefore the final mapping) is exactly the one the
+ * sequential loop builds.
  */
 public class Mapper { // Mapper class for line mapping
 
@@ -15,19 +23,54 @@ public class Mapper { // Mapper class for line mapping
     private final double similarityThreshold; // this is for accepting a match
     private final boolean enableSplitRefinement; // this is for Step 5
     private final int maxSplitLength; // for split refinement
+    private final ExecutorService scoringPool; // null = score on the calling thread
+    private final PipelineMetrics metrics;     // null = not measured
+
+    private static final int SCORING_CHUNK = 64; // old lines per parallel scoring task
 
     public Mapper(SimilarityCalculator similarityCalculator, // similarity calculator
                   double similarityThreshold,
                   boolean enableSplitRefinement,
                   int maxSplitLength) {
+        this(similarityCalculator, similarityThreshold, enableSplitRefinement, maxSplitLength, null);
+    }
+
+    /**
+     * @param scoringPool pool used to score candidates in parallel (the caller owns
+     *                    and shuts it down), or null to score sequentially
+     */
+    public Mapper(SimilarityCalculator similarityCalculator,
+                  double similarityThreshold,
+                  boolean enableSplitRefinement,
+                  int maxSplitLength,
+                  ExecutorService scoringPool) {
+        this(similarityCalculator, similarityThreshold, enableSplitRefinement, maxSplitLength, scoringPool, null);
+    }
+
+    /**
+     * @param metrics where to count scored pairs, accepted matches and split groups
+     *                (and time scoring / assignment / splits), or null
+     */
+    public Mapper(SimilarityCalculator similarityCalculator,
+                  double similarityThreshold,
+                  boolean enableSplitRefinement,
+                  int maxSplitLength,
+                  ExecutorService scoringPool,
+                  PipelineMetrics metrics) {
         this.similarityCalculator = similarityCalculator;
         this.similarityThreshold = similarityThreshold;
         this.enableSplitRefinement = enableSplitRefinement;
         this.maxSplitLength = maxSplitLength;
+        this.scoringPool = scoringPool;
+        this.metrics = metrics;
+    }
+
+    PipelineMetrics getMetrics() {
+        return metrics;
     }
 
     
-    private static class CandidateMatch { // this is for internal use because we need to sort by score
+    static class CandidateMatch { // this is for internal use because we need to sort by score
         final int oldLine;
         final int newLine;
         final double score; // combined similarity score
@@ -81,21 +124,11 @@ public class Mapper { // Mapper class for line mapping
         unmatchedNewLines.removeAll(usedNewLines);
 
         // Build candidate matches with scores
-        List<CandidateMatch> matches = new ArrayList<>();
-        for (int oldLine : unmatchedOldLines) {
-            List<Integer> candidates = candidateLists.getOrDefault(oldLine, List.of()); // here we get candidates
-            for (int newLine : candidates) {
-                double score = similarityCalculator.combinedSimilarity( // calculate combined similarity
-                        oldFile, oldLine,
-                        newFile, newLine
-                );
-                matches.add(new CandidateMatch(oldLine, newLine, score));
-            }
+        List<CandidateMatch> matches;
+        try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.SCORING)) {
+            matches = scoreCandidates(oldFile, newFile, unmatchedOldLines, candidateLists);
         }
 
-        // Sort by score descending (best first)
-        matches.sort((a, b) -> Double.compare(b.score, a.score));
-
         Map<Integer, Integer> finalMapping = new HashMap<>(unchangedMapping); // this is the final mapping we will build
         Map<Integer, Double> bestScores = new HashMap<>();
 
@@ -106,7 +139,108 @@ public class Mapper { // Mapper class for line mapping
 
         Set<Integer> mappedOldLines = new HashSet<>(unchangedMapping.keySet());
 
-        
+        try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.ASSIGNMENT)) {
+            assignMatches(matches, finalMapping, bestScores, mappedOldLines, usedNewLines);
+        }
+
+        return buildEntries(oldFile, newFile, unchangedMapping, finalMapping, bestScores);
+    }
+
+    /**
+     * Score every (old line, candidate) pair. The list keeps the order of oldLines,
+     * then the order of each candidate list.
+     *
+     * Pairs whose SimilarityCalculator.upperBound is already below the threshold are
+     * left out without scoring (counted in pairsPruned). assignMatches stops at the
+     * threshold anyway, so the mapping is the same as with every pair scored.
+     */
+    List<CandidateMatch> scoreCandidates(FileVersion oldFile,
+                                         FileVersion newFile,
+                                         Collection<Integer> oldLines,
+                                         Map<Integer, List<Integer>> candidateLists) {
+        if (scoringPool == null || oldLines.size() <= SCORING_CHUNK) {
+            List<CandidateMatch> matches = new ArrayList<>();
+            scoreInto(oldFile, newFile, oldLines, candidateLists, matches);
+            return matches;
+        }
+
+        // same iteration order as the sequential loop, cut into chunks
+        List<Integer> ordered = new ArrayList<>(oldLines);
+        List<Future<List<CandidateMatch>>> chunks = new ArrayList<>();
+        for (int from = 0; from < ordered.size(); from += SCORING_CHUNK) {
+            List<Integer> chunk = ordered.subList(from, Math.min(ordered.size(), from + SCORING_CHUNK));
+            chunks.add(scoringPool.submit(() -> {
+                long allocatedBefore = metrics == null ? -1 : AllocationCounter.currentThreadAllocatedBytes();
+                List<CandidateMatch> buffer = new ArrayList<>(); // this task's own buffer
+                scoreInto(oldFile, newFile, chunk, candidateLists, buffer);
+                if (metrics != null) metrics.addAllocated(PipelineMetrics.Stage.SCORING, allocatedBefore);
+                return buffer;
+            }));
+        }
+
+        List<CandidateMatch> matches = new ArrayList<>();
+        try {
+            for (Future<List<CandidateMatch>> chunk : chunks) {
+                matches.addAll(chunk.get()); // chunk order = sequential order
+            }
+        } catch (InterruptedException ex) {
+            Thread.currentThread().interrupt();
+            throw new RuntimeException(ex);
+        } catch (ExecutionException ex) {
+            throw new RuntimeException(ex.getCause());
+        }
+        return matches;
+    }
+
+    private void scoreInto(FileVersion oldFile,
+                           FileVersion newFile,
+                           Collection<Integer> oldLines,
+                           Map<Integer, List<Integer>> candidateLists,
+                           List<CandidateMatch> matches) {
+        int before = matches.size();
+        int pruned = 0;
+        int[] block = new int[16];       // surviving candidates of one old line
+        double[] scores = new double[16];
+        for (int oldLine : oldLines) {
+            List<Integer> candidates = candidateLists.getOrDefault(oldLine, List.of()); // here we get candidates
+            LineRecord oldRec = getLine(oldFile, oldLine);
+            if (candidates.size() > block.length) {
+                block = new int[candidates.size()];
+                scores = new double[candidates.size()];
+            }
+            int count = 0;
+            for (int newLine : candidates) {
+                if (similarityCalculator.upperBound(oldRec, getLine(newFile, newLine)) < similarityThreshold) {
+                    pruned++; // token counts too far apart, cannot reach the threshold
+                    continue;
+                }
+                block[count++] = newLine;
+            }
+            if (count == 0) continue;
+            // score the old line against all of them in one go (same scores as pair by pair)
+            similarityCalculator.combinedSimilarityBlock(oldFile, oldLine, newFile, block, count, scores);
+            for (int k = 0; k < count; k++) {
+                matches.add(new CandidateMatch(oldLine, block[k], scores[k]));
+            }
+        }
+        if (metrics != null) {
+            metrics.pairsScored.add(matches.size() - before);
+            metrics.pairsPruned.add(pruned);
+        }
+    }
+
+    /**
+     * Greedy assignment: best score first, each old and new line used at most once,
+     * stop at the threshold. Updates the maps/sets passed in.
+     */
+    void assignMatches(List<CandidateMatch> matches,
+                       Map<Integer, Integer> finalMapping,
+                       Map<Integer, Double> bestScores,
+                       Set<Integer> mappedOldLines,
+                       Set<Integer> usedNewLines) {
+        // Sort by score descending (best first)
+        matches.sort((a, b) -> Double.compare(b.score, a.score));
+
         for (CandidateMatch m : matches) { // here we select the best matches
             if (m.score < similarityThreshold) {
                 // because matches list is sorted descending by score
@@ -120,22 +254,38 @@ public class Mapper { // Mapper class for line mapping
             mappedOldLines.add(m.oldLine);
             usedNewLines.add(m.newLine);
         }
+    }
 
-        
-        for (int oldLine : allOldLines) {    // here we mark unmatched old lines as deleted
+    /**
+     * Mark the old lines that got nothing as deleted, run split refinement and
+     * build one MappingEntry per old line.
+     */
+    List<MappingEntry> buildEntries(FileVersion oldFile,
+                                    FileVersion newFile,
+                                    Map<Integer, Integer> unchangedMapping,
+                                    Map<Integer, Integer> finalMapping,
+                                    Map<Integer, Double> bestScores) {
+        int oldSize = oldFile.getLines().size();
+
+        for (int oldLine = 1; oldLine <= oldSize; oldLine++) {    // here we mark unmatched old lines as deleted
             finalMapping.putIfAbsent(oldLine, -1);
             bestScores.putIfAbsent(oldLine, 0.0);
         }
 
         
+        Map<Integer, Integer> splitEnds = Collections.emptyMap(); // oldLine -> last new line of its split group
         if (enableSplitRefinement) {    // this is the step we refine splits
-            refineSplits(oldFile, newFile, finalMapping);
+            try (PipelineMetrics.Span ignored = PipelineMetrics.span(metrics, PipelineMetrics.Stage.SPLITS)) {
+                splitEnds = refineSplits(oldFile, newFile, finalMapping);
+            }
         }
 
         
         List<MappingEntry> result = new ArrayList<>();  // here we build the final list of MappingEntry
         for (int oldLine = 1; oldLine <= oldSize; oldLine++) {
             int newLine = finalMapping.getOrDefault(oldLine, -1);
+            int newLineEnd = splitEnds.getOrDefault(oldLine, newLine);
+            double score = bestScores.getOrDefault(oldLine, 0.0);
             String status;
 
             if (unchangedMapping.containsKey(oldLine)) {
@@ -143,15 +293,16 @@ public class Mapper { // Mapper class for line mapping
             } else if (newLine == -1) {
                 status = "deleted";
             } else {
-                double score = bestScores.getOrDefault(oldLine, 0.0);
                 if (score >= 0.9) {
                     status = "modified(minor)";
+                    if (metrics != null) metrics.acceptedMinor.increment();
                 } else {
                     status = "modified";
+                    if (metrics != null) metrics.acceptedBelowMinor.increment();
                 }
             }
 
-            result.add(new MappingEntry(oldLine, newLine, status)); // here we add the mapping entry
+            result.add(new MappingEntry(oldLine, newLine, newLineEnd, status, score)); // here we add the mapping entry
         }
 
         return result;
@@ -160,41 +311,70 @@ public class Mapper { // Mapper class for line mapping
     /**
      * Step 5: refinement for line splits.
      *
-     * For now, we only compute the best group [newLine .. newLine + k]
-     * but we do NOT change the numeric mapping (still oldLine -> first new line).
-     * You can store the groups in some data structure for the GUI if needed.
+     * For every mapped old line we grow a group [newLine .. newLine + k] over the
+     * following new lines that nothing else is mapped to, as long as the content score
+     * of the old line against the whole group keeps going up. The numeric
+     * mapping stays oldLine -> first new line; the group end comes back per old line
+     * and ends up in MappingEntry.newLineEnd, so the writers can print 1:N mappings.
+     *
+     * The group is judged with the content score of --similarity: token Jaccard for
+     * JACCARD and SIMHASH (SimHash only estimates Jaccard, and its exact fallback is
+     * Jaccard), edit similarity of the old line against the group's lines joined by
+     * spaces for LEVENSHTEIN. So a pair is grown by the same measure that accepted it.
+     *
+     * For Jaccard the group tokens are a small hash set (GroupTokens), so adding a line
+     * costs only that line's tokens instead of re-merging the whole group every step.
+     * It is made for the first old line that has a free new line to grow into, and
+     * sized by the tokens of the groups, not by the dictionary.
+     *
+     * @return oldLine -> last new line of its group, only for groups of 2+ lines
      */
-    private void refineSplits(FileVersion oldFile,  // we will split lines here
-                              FileVersion newFile,
-                              Map<Integer, Integer> mapping) {
+    private Map<Integer, Integer> refineSplits(FileVersion oldFile,  // we will split lines here
+                                               FileVersion newFile,
+                                               Map<Integer, Integer> mapping) {
 
+        int oldSize = oldFile.getLines().size();
         int newSize = newFile.getLines().size();
-        Map<Integer, List<Integer>> splitGroups = new HashMap<>();
+        Map<Integer, Integer> splitEnds = new HashMap<>();
+
+        boolean[] usedNew = new boolean[newSize + 1]; // new lines that are already a target
+        for (int newLine : mapping.values()) {
+            if (newLine > 0) usedNew[newLine] = true;
+        }
 
-        for (Map.Entry<Integer, Integer> entry : mapping.entrySet()) {  // over here we find split groups
-            int oldLine = entry.getKey();
-            int newLine = entry.getValue();
+        boolean levenshtein = similarityCalculator.getMode() == SimilarityCalculator.Mode.LEVENSHTEIN;
+        GroupTokens group = null; // Jaccard only, and only needed once some line can grow
 
+        for (int oldLine = 1; oldLine <= oldSize; oldLine++) {  // in line order, so the groups do not depend on hashing
+            int newLine = mapping.getOrDefault(oldLine, -1);
             if (newLine == -1) continue; // deleted
+            if (newLine + 1 > newSize || usedNew[newLine + 1]) continue; // nothing free to grow into
 
             LineRecord oldRec = getLine(oldFile, oldLine);
-            String oldNorm = oldRec.getNormalizedText();
 
             int bestEnd = newLine;
-            double bestScore = similarityCalculator.contentSimilarity(
-                    oldRec, getLine(newFile, newLine));
-
-            StringBuilder concatenated = new StringBuilder(
-                    getLine(newFile, newLine).getNormalizedText()
-            );
-
+            double bestScore;
+            String oldText = null;
+            StringBuilder groupText = null;
+            if (levenshtein) {
+                oldText = oldRec.getNormalizedText();
+                groupText = new StringBuilder(getLine(newFile, newLine).getNormalizedText());
+                bestScore = similarityCalculator.editSimilarity(oldText, groupText, 0.0);
+            } else {
+                bestScore = similarityCalculator.contentSimilarity(oldRec, getLine(newFile, newLine));
+                if (group == null) group = new GroupTokens();
+                group.start(oldRec.getTokenIds(), getLine(newFile, newLine).getTokenIds());
+            }
             for (int next = newLine + 1;
-                 next <= newSize && next <= newLine + maxSplitLength;
+                 next <= newSize && next <= newLine + maxSplitLength && !usedNew[next];
                  next++) {
-                concatenated.append(" ")
-                        .append(getLine(newFile, next).getNormalizedText());
-
-                double newScore = contentSimilarityForString(oldNorm, concatenated.toString());
+                double newScore;
+                if (levenshtein) {
+                    groupText.append(' ').append(getLine(newFile, next).getNormalizedText());
+                    newScore = similarityCalculator.editSimilarity(oldText, groupText, bestScore);
+                } else {
+                    newScore = group.add(getLine(newFile, next).getTokenIds());
+                }
 
                 if (newScore > bestScore) {
                     bestScore = newScore;
@@ -204,50 +384,101 @@ public class Mapper { // Mapper class for line mapping
                     break;
                 }
             }
+            if (group != null) group.clear();
 
             if (bestEnd > newLine) { // finally we store the split group
-                List<Integer> group = new ArrayList<>();
-                for (int i = newLine; i <= bestEnd; i++) {
-                    group.add(i);
+                for (int i = newLine + 1; i <= bestEnd; i++) {
+                    usedNew[i] = true; // a new line belongs to one group only
                 }
-                splitGroups.put(oldLine, group);
+                splitEnds.put(oldLine, bestEnd);
             }
         }
 
-        // For now, we do not change the numeric mapping in 'mapping'.
+        if (metrics != null) metrics.splitGroups.add(splitEnds.size());
+
+        return splitEnds;
     }
 
-    // ----- helpers -----
+    // Jaccard of one old line against a growing group of new lines.
+    // The group's distinct tokens live in an open-addressing set of ids (a group is a
+    // few lines, so a few dozen ids); the old line's ids are sorted, so membership
+    // there is a binary search. distinct/common are kept up to date as lines join.
+    private static class GroupTokens {
+        private static final int EMPTY = -1; // token ids are >= 0
+
+        private int[] slots = newSlots(32);
+        private int[] oldTokens = new int[0];
+        private int[] touched = new int[16]; // filled slots, to reset cheaply
+        private int touchedCount;            // = distinct group tokens
+        private int common;                  // |old ∩ group|
+
+        void start(int[] oldTokenIds, int[] firstLine) {
+            oldTokens = oldTokenIds;
+            add(firstLine);
+        }
 
-    private LineRecord getLine(FileVersion file, int lineNumber) {
-        return file.getLines().get(lineNumber - 1);
-    }
+        // adds one new line to the group and returns the Jaccard of the whole group
+        double add(int[] tokenIds) {
+            for (int id : tokenIds) {
+                if (insert(id) && Arrays.binarySearch(oldTokens, id) >= 0) common++;
+            }
+            if (oldTokens.length == 0 && touchedCount == 0) {
+                return 1.0; // same convention as JaccardKernel
+            }
+            return (double) common / (oldTokens.length + touchedCount - common);
+        }
 
-    // simple Jaccard for old line vs concatenation of new lines
-    private double contentSimilarityForString(String normOld, String normNewGroup) {
-        Set<String> tokensOld = tokenize(normOld);
-        Set<String> tokensNew = tokenize(normNewGroup);
+        void clear() {
+            for (int i = 0; i < touchedCount; i++) slots[touched[i]] = EMPTY;
+            touchedCount = 0;
+            common = 0;
+        }
 
-        if (tokensOld.isEmpty() && tokensNew.isEmpty()) return 1.0;
-        Set<String> intersection = new HashSet<>(tokensOld);
-        intersection.retainAll(tokensNew);
+        // true if id was not in the group yet
+        private boolean insert(int id) {
+            if (2 * (touchedCount + 1) > slots.length) grow();
+            int mask = slots.length - 1;
+            int slot = mix(id) & mask;
+            while (slots[slot] != EMPTY) {
+                if (slots[slot] == id) return false;
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = id;
+            if (touchedCount == touched.length) touched = Arrays.copyOf(touched, 2 * touchedCount);
+            touched[touchedCount++] = slot;
+            return true;
+        }
 
-        Set<String> union = new HashSet<>(tokensOld);
-        union.addAll(tokensNew);
+        // double the table and put the current ids back (load stays <= 1/2)
+        private void grow() {
+            int[] old = slots;
+            int[] oldTouched = Arrays.copyOf(touched, touchedCount);
+            slots = newSlots(2 * old.length);
+            int mask = slots.length - 1;
+            for (int i = 0; i < oldTouched.length; i++) {
+                int id = old[oldTouched[i]];
+                int slot = mix(id) & mask;
+                while (slots[slot] != EMPTY) slot = (slot + 1) & mask;
+                slots[slot] = id;
+                touched[i] = slot;
+            }
+        }
 
-        if (union.isEmpty()) return 0.0;
-        return (double) intersection.size() / union.size();
-    }
+        private static int[] newSlots(int size) {
+            int[] slots = new int[size];
+            Arrays.fill(slots, EMPTY);
+            return slots;
+        }
 
-    private Set<String> tokenize(String text) {
-        if (text == null || text.isBlank()) return Collections.emptySet();
-        String[] parts = text.split("\\W+");
-        Set<String> tokens = new HashSet<>();
-        for (String p : parts) {
-            if (!p.isBlank()) tokens.add(p);
+        // dictionary ids are dense, spread them over the table
+        private static int mix(int id) {
+            return id * 0x9E3779B9 ^ (id * 0x9E3779B9 >>> 16);
         }
-        return tokens;
     }
-}
 
+    // ----- helpers -----
 
+    private LineRecord getLine(FileVersion file, int lineNumber) {
+        return file.getLines().get(lineNumber - 1);
+    }
+}
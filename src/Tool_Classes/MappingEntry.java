@@ -4,11 +4,30 @@ package tool;
 public class MappingEntry {
     public final int oldLine;   // -1 if added
     public final int newLine;   // -1 if deleted
+    public final int newLineEnd; // last new line when the old line was split over newLine..newLineEnd, else newLine
     public final String status; // "unchanged", "added", "deleted", "modified(minor)" etc.
+    public final double score;  // combined similarity of the match (1.0 unchanged, 0.0 deleted), NaN = unknown
 
     public MappingEntry(int oldLine, int newLine, String status) {
+        this(oldLine, newLine, status, Double.NaN);
+    }
+
+    public MappingEntry(int oldLine, int newLine, String status, double score) {
+        this(oldLine, newLine, newLine, status, score);
+    }
+
+    public MappingEntry(int oldLine, int newLine, int newLineEnd, String status, double score) {
         this.oldLine = oldLine;
         this.newLine = newLine;
+        this.newLineEnd = newLineEnd;
         this.status = status;
+        this.score = score;
+    }
+
+    /**
+     * True when the old line maps to more than one new line (a split).
+     */
+    public boolean isSplit() {
+        return newLineEnd > newLine;
     }
 }
@@ -0,0 +1,47 @@
+package tool;
+
+
+import java.io.IOException;
+import java.nio.file.Path;
+
+/**
+ * Step 6: one way of writing a finished mapping to a file.
+ *
+ *  - TextMappingFormat       "ORIG NEW" lines (the default, what the course tools read)
+ *  - XmlMappingFormat        <LOCATION ORIG NEW/> like the LHDiff ground truth files
+ *  - JsonLinesMappingFormat  one JSON object per old line, with status and score
+ *  - BinaryMappingFormat     delta + varint encoded, with an index for lookups by old line
+ *
+ * Every format streams straight from the MappingTable arrays, in old line order.
+ */
+public interface MappingFormat {
+
+    /**
+     * Output formats selectable with --format, with the file extension the batch and
+     * chain tools give their output files (foo.java.map.txt, foo.java.map.jsonl, ...).
+     */
+    enum Kind {
+        TEXT(".txt"), XML(".xml"), JSONL(".jsonl"), BINARY(".bin");
+
+        final String extension;
+
+        Kind(String extension) {
+            this.extension = extension;
+        }
+    }
+
+    void write(MappingTable table, Path out) throws IOException;
+
+    static MappingFormat of(Kind kind) {
+        switch (kind) {
+            case XML:
+                return new XmlMappingFormat();
+            case JSONL:
+                return new JsonLinesMappingFormat();
+            case BINARY:
+                return new BinaryMappingFormat();
+            default:
+                return new TextMappingFormat();
+        }
+    }
+}
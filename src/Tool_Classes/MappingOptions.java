@@ -0,0 +1,335 @@
+package tool;
+
+
+import java.util.Locale;
+
+/**
+ * Knobs for one LineMappingTool run.
+ * The defaults are the values the pipeline always used, so a run without flags gives
+ * the original tool's mappings. --strip-comments is opt-in: with it an edit that only
+ * touches a trailing comment normalizes to the same text and the line counts as
+ * unchanged, where the original tool called it modified.
+ */
+public class MappingOptions {
+
+    public static final String USAGE = String.join("\n",
+            "Options:",
+            "  --anchor=greedy|diff          Step 2 exact matching (default greedy)",
+            "  --candidates=window|index|minhash  Step 3 candidate source (default window)",
+            "  --top-k=N                     index/minhash: candidates per old line (default 10)",
+            "  --max-token-share=X           index: skip tokens in more than X of new lines (default 0.05)",
+            "  --bands=N --rows=N            minhash: LSH bands and rows per band (default 16 x 4)",
+            "  --similarity=jaccard|simhash|levenshtein  Step 4 scoring (default jaccard)",
+            "  --simhash-band=X              simhash: redo scores within X of the threshold (default 0.1)",
+            "  --hunks                       map each gap between unchanged lines separately, in parallel",
+            "  --cross-hunk-moves=true|false hunks: extra pass for lines moved across gaps (default true)",
+            "  --parallel-scoring            score candidates on --threads threads (same mapping as sequential)",
+            "  --threads=N                   worker threads (default: number of cores)",
+            "  --strip-comments=true|false   Step 1: drop comments by file extension (default false;",
+            "                                comment-only lines keep their comment text)",
+            "  --cache-dir=<path>            Step 1: reuse preprocessed files from this folder (by content hash)",
+            "  --stats                       print counts and allocated bytes to stderr",
+            "                                (minhash: also recall against the window source)",
+            "  --report=<file>               write per-stage time/allocation and pipeline counters as JSON",
+            "  --format=text|xml|jsonl|binary  Step 6 output format (default text)");
+
+    /**
+     * How Step 2 finds unchanged lines.
+     *  GREEDY - UnchangedDetector, first unused exact match anywhere in the file
+     *  DIFF   - DiffAnchorDetector, prefix/suffix trim + patience/Myers diff (keeps order)
+     */
+    public enum AnchorMode { GREEDY, DIFF }
+
+    /**
+     * Where Step 3 looks for candidates.
+     *  WINDOW - CandidateGenerator, +/-15 lines around the same line number
+     *  INDEX  - InvertedIndexCandidateGenerator, shared tokens anywhere in the file (top-k)
+     *  MINHASH - MinHashCandidateGenerator, banded LSH over MinHash signatures (top-k)
+     */
+    public enum CandidateMode { WINDOW, INDEX, MINHASH }
+
+    private AnchorMode anchorMode = AnchorMode.GREEDY;
+    private CandidateMode candidateMode = CandidateMode.WINDOW;
+    private int candidateTopK = 10;          // INDEX: max candidates per old line
+    private double maxTokenShare = 0.05;     // INDEX: skip tokens in more than 5% of unmatched new lines
+    private int lshBands = 16;               // MINHASH: number of bands
+    private int lshRows = 4;                 // MINHASH: signature values per band
+    private SimilarityCalculator.Mode similarityMode = SimilarityCalculator.Mode.JACCARD;
+    private double simHashFallbackBand = 0.1; // SIMHASH: redo scores this close to 0.6 with Jaccard
+    private boolean hunkMode = false;        // Steps 3-4 per hunk between unchanged lines (HunkMapper)
+    private boolean crossHunkMoves = true;   // hunk mode: extra pass to find lines moved across hunks
+    private boolean parallelScoring = false; // score candidates on a thread pool (same result as sequential)
+    private int threads = Runtime.getRuntime().availableProcessors();
+    private boolean stripComments = false;   // Step 1: Normalizer profile from the file extension
+    private String cacheDir = null;          // Step 1: PreprocessCache folder, null = no cache
+    private boolean printStats = false; // print token/allocation counts to stderr after the run
+    private String reportFile = null;   // PipelineMetrics JSON report, null = none
+    private MappingFormat.Kind outputFormat = MappingFormat.Kind.TEXT; // Step 6 MappingWriter format
+
+    /**
+     * A separate MappingOptions with the same values, for tools that adjust a copy
+     * (e.g. BatchMappingTool's per-pair thread count).
+     */
+    public MappingOptions copy() {
+        MappingOptions copy = new MappingOptions();
+        copy.anchorMode = anchorMode;
+        copy.candidateMode = candidateMode;
+        copy.candidateTopK = candidateTopK;
+        copy.maxTokenShare = maxTokenShare;
+        copy.lshBands = lshBands;
+        copy.lshRows = lshRows;
+        copy.similarityMode = similarityMode;
+        copy.simHashFallbackBand = simHashFallbackBand;
+        copy.hunkMode = hunkMode;
+        copy.crossHunkMoves = crossHunkMoves;
+        copy.parallelScoring = parallelScoring;
+        copy.threads = threads;
+        copy.stripComments = stripComments;
+        copy.cacheDir = cacheDir;
+        copy.printStats = printStats;
+        copy.reportFile = reportFile;
+        copy.outputFormat = outputFormat;
+        return copy;
+    }
+
+    public AnchorMode getAnchorMode() {
+        return anchorMode;
+    }
+
+    public MappingOptions setAnchorMode(AnchorMode anchorMode) {
+        this.anchorMode = anchorMode;
+        return this;
+    }
+
+    public CandidateMode getCandidateMode() {
+        return candidateMode;
+    }
+
+    public MappingOptions setCandidateMode(CandidateMode candidateMode) {
+        this.candidateMode = candidateMode;
+        return this;
+    }
+
+    public int getCandidateTopK() {
+        return candidateTopK;
+    }
+
+    public MappingOptions setCandidateTopK(int candidateTopK) {
+        this.candidateTopK = candidateTopK;
+        return this;
+    }
+
+    public double getMaxTokenShare() {
+        return maxTokenShare;
+    }
+
+    public MappingOptions setMaxTokenShare(double maxTokenShare) {
+        this.maxTokenShare = maxTokenShare;
+        return this;
+    }
+
+    public int getLshBands() {
+        return lshBands;
+    }
+
+    public MappingOptions setLshBands(int lshBands) {
+        this.lshBands = lshBands;
+        return this;
+    }
+
+    public int getLshRows() {
+        return lshRows;
+    }
+
+    public MappingOptions setLshRows(int lshRows) {
+        this.lshRows = lshRows;
+        return this;
+    }
+
+    public SimilarityCalculator.Mode getSimilarityMode() {
+        return similarityMode;
+    }
+
+    public MappingOptions setSimilarityMode(SimilarityCalculator.Mode similarityMode) {
+        this.similarityMode = similarityMode;
+        return this;
+    }
+
+    public double getSimHashFallbackBand() {
+        return simHashFallbackBand;
+    }
+
+    public MappingOptions setSimHashFallbackBand(double simHashFallbackBand) {
+        this.simHashFallbackBand = simHashFallbackBand;
+        return this;
+    }
+
+    public boolean isHunkMode() {
+        return hunkMode;
+    }
+
+    public MappingOptions setHunkMode(boolean hunkMode) {
+        this.hunkMode = hunkMode;
+        return this;
+    }
+
+    public boolean isCrossHunkMoves() {
+        return crossHunkMoves;
+    }
+
+    public MappingOptions setCrossHunkMoves(boolean crossHunkMoves) {
+        this.crossHunkMoves = crossHunkMoves;
+        return this;
+    }
+
+    public boolean isParallelScoring() {
+        return parallelScoring;
+    }
+
+    public MappingOptions setParallelScoring(boolean parallelScoring) {
+        this.parallelScoring = parallelScoring;
+        return this;
+    }
+
+    public int getThreads() {
+        return threads;
+    }
+
+    public MappingOptions setThreads(int threads) {
+        this.threads = threads;
+        return this;
+    }
+
+    public boolean isStripComments() {
+        return stripComments;
+    }
+
+    public MappingOptions setStripComments(boolean stripComments) {
+        this.stripComments = stripComments;
+        return this;
+    }
+
+    public String getCacheDir() {
+        return cacheDir;
+    }
+
+    public MappingOptions setCacheDir(String cacheDir) {
+        this.cacheDir = cacheDir;
+        return this;
+    }
+
+    public boolean isPrintStats() {
+        return printStats;
+    }
+
+    public MappingOptions setPrintStats(boolean printStats) {
+        this.printStats = printStats;
+        return this;
+    }
+
+    public String getReportFile() {
+        return reportFile;
+    }
+
+    public MappingOptions setReportFile(String reportFile) {
+        this.reportFile = reportFile;
+        return this;
+    }
+
+    public MappingFormat.Kind getOutputFormat() {
+        return outputFormat;
+    }
+
+    public MappingOptions setOutputFormat(MappingFormat.Kind outputFormat) {
+        this.outputFormat = outputFormat;
+        return this;
+    }
+
+    /**
+     * Apply one "--name=value" command line flag.
+     *
+     * @return false if the flag is not known or its value does not parse or is out of
+     *         range (e.g. --anchor=dif, --threads=x, --threads=0); the options are then unchanged
+     */
+    public boolean applyFlag(String flag) {
+        int eq = flag.indexOf('=');
+        String name = eq < 0 ? flag : flag.substring(0, eq);
+        String value = eq < 0 ? "" : flag.substring(eq + 1);
+        try {
+            return apply(name, value);
+        } catch (IllegalArgumentException ex) { // bad enum name or number
+            return false;
+        }
+    }
+
+    private boolean apply(String name, String value) {
+        switch (name) {
+            case "--anchor":
+                anchorMode = AnchorMode.valueOf(value.toUpperCase(Locale.ROOT));
+                return true;
+            case "--candidates":
+                candidateMode = CandidateMode.valueOf(value.toUpperCase(Locale.ROOT));
+                return true;
+            case "--top-k":
+                candidateTopK = parsePositive(value);
+                return true;
+            case "--max-token-share":
+                maxTokenShare = Double.parseDouble(value);
+                return true;
+            case "--bands":
+                lshBands = parsePositive(value);
+                return true;
+            case "--rows":
+                lshRows = parsePositive(value);
+                return true;
+            case "--similarity":
+                similarityMode = SimilarityCalculator.Mode.valueOf(value.toUpperCase(Locale.ROOT));
+                return true;
+            case "--simhash-band":
+                simHashFallbackBand = Double.parseDouble(value);
+                return true;
+            case "--hunks":
+                hunkMode = value.isEmpty() || Boolean.parseBoolean(value);
+                return true;
+            case "--cross-hunk-moves":
+                crossHunkMoves = value.isEmpty() || Boolean.parseBoolean(value);
+                return true;
+            case "--parallel-scoring":
+                parallelScoring = value.isEmpty() || Boolean.parseBoolean(value);
+                return true;
+            case "--threads":
+                threads = parsePositive(value);
+                return true;
+            case "--strip-comments":
+                stripComments = value.isEmpty() || Boolean.parseBoolean(value);
+                return true;
+            case "--cache-dir":
+                cacheDir = value.isEmpty() ? null : value;
+                return true;
+            case "--stats":
+                printStats = value.isEmpty() || Boolean.parseBoolean(value);
+                return true;
+            case "--report":
+                reportFile = value.isEmpty() ? null : value;
+                return true;
+            case "--format":
+                outputFormat = MappingFormat.Kind.valueOf(value.toUpperCase(Locale.ROOT));
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Integer.parseInt for counts that must be at least 1 (threads, jobs, top-k, bands, rows).
+     *
+     * @throws IllegalArgumentException (NumberFormatException for non-numbers) if value is not a number >= 1
+     */
+    static int parsePositive(String value) {
+        int n = Integer.parseInt(value);
+        if (n < 1) {
+            throw new IllegalArgumentException("must be at least 1: " + value);
+        }
+        return n;
+    }
+}
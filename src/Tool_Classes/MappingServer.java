@@ -0,0 +1,436 @@
+package tool;
+
+import java.io.BufferedReader;
+import java.io.BufferedWriter;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InputStreamReader;
+import java.io.OutputStream;
+import java.io.OutputStreamWriter;
+import java.io.Writer;
+import java.net.StandardProtocolFamily;
+import java.net.UnixDomainSocketAddress;
+import java.nio.channels.Channels;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.FileSystems;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardCopyOption;
+import java.nio.file.attribute.PosixFilePermissions;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * DAEMON MODE:
+ * Keeps one warmed-up JVM around and maps file pairs on request, so editors / CI hooks
+ * don't pay JVM startup + JIT warmup for every pair.
+ *
+ * Protocol: JSON lines. One request per line, one response per line (in completion order,
+ * match them up by "id"):
+ *
+ *   {"id": 1, "old": "a/Foo.java", "new": "b/Foo.java"}
+ *   {"id": 2, "old": "...", "new": "...", "out": "map.txt", "options": {"anchor": "diff", "hunks": true}}
+ *   {"cmd": "stats"}      counters of this server
+ *   {"cmd": "shutdown"}   stop accepting requests, finish the running ones, exit
+ *
+ *   {"id":1,"ok":true,"oldLines":120,"newLines":118,"queueMs":0.1,"latencyMs":4.2,"mapping":[[1,1],[2,-1],...]}
+ *   {"id":2,"ok":true,...,"out":"map.txt"}       mapping written to the file instead
+ *   {"id":3,"ok":false,"error":"..."}
+ *   {"id":4,"ok":false,"error":"shutting down"}  sent after a "shutdown" from any connection
+ *
+ * A "mapping" item is [old,new], or [old,new,newEnd] when the old line was split over
+ * the new lines new..newEnd (like "newEnd" in the JSONL format).
+ *
+ * "options" keys are the MappingOptions flags without the leading "--"; they are applied
+ * on top of the flags the server was started with. latencyMs is from reading the request
+ * to writing the response, queueMs is the part of it spent waiting for a worker.
+ *
+ * Transport: stdin/stdout by default, or a Unix domain socket with --socket=<path>
+ * (needs Java 16+), where every connection gets its own request/response stream.
+ * Requests from all connections share one pool of --jobs workers.
+ *
+ * Trust model: whoever can send a request can make the server read any file it can
+ * read ("old", "new") and write wherever it can write ("out", the "cache-dir" option),
+ * with the server's user rights. So the socket is for the user that started the server
+ * only: it is created owner-only (0600, bound inside a 0700 directory and then moved
+ * into place, so no other user can connect in between). Don't loosen its permissions or
+ * put it behind anything that forwards other users' requests; to serve several users
+ * run one server per user.
+ */
+public class MappingServer {
+
+    private static final String USAGE = String.join("\n",
+            "Usage: java tool.MappingServer [--jobs=N] [--socket=<path>] [--warmup=N] [options]",
+            "  --jobs=N         requests mapped at the same time (default: number of cores)",
+            "  --socket=<path>  listen on a Unix domain socket instead of stdin/stdout (owner-only)",
+            "  --warmup=N       map a generated pair N times before serving (default 20)");
+
+    private final List<String> baseFlags; // MappingOptions flags from the command line
+    private final ExecutorService workers;
+
+    private volatile boolean shuttingDown = false;
+    private final AtomicLong served = new AtomicLong();
+    private final AtomicLong failed = new AtomicLong();
+    private final AtomicLong totalLatencyNanos = new AtomicLong();
+
+    public MappingServer(List<String> baseFlags, int jobs) {
+        this.baseFlags = baseFlags;
+        this.workers = Executors.newFixedThreadPool(jobs);
+    }
+
+    public static void main(String[] args) throws IOException, InterruptedException {
+        int jobs = Runtime.getRuntime().availableProcessors();
+        String socketPath = null;
+        int warmupRuns = 20;
+        List<String> flags = new ArrayList<>();
+
+        for (String arg : args) {
+            boolean ok = true;
+            try {
+                if (arg.startsWith("--jobs=")) {
+                    jobs = MappingOptions.parsePositive(arg.substring("--jobs=".length()));
+                } else if (arg.startsWith("--socket=")) {
+                    socketPath = arg.substring("--socket=".length());
+                } else if (arg.startsWith("--warmup=")) {
+                    warmupRuns = Integer.parseInt(arg.substring("--warmup=".length()));
+                    ok = warmupRuns >= 0;
+                } else if (arg.startsWith("--") && new MappingOptions().applyFlag(arg)) {
+                    flags.add(arg);
+                } else {
+                    ok = false;
+                }
+            } catch (IllegalArgumentException ex) { // not a number, or --jobs below 1
+                ok = false;
+            }
+            if (!ok) {
+                System.err.println("Unknown option or bad value: " + arg);
+                System.err.println(USAGE);
+                System.err.println(MappingOptions.USAGE);
+                System.exit(1);
+            }
+        }
+
+        MappingServer server = new MappingServer(flags, jobs);
+        server.warmUp(warmupRuns);
+        if (socketPath == null) {
+            server.serveStdio();
+        } else {
+            server.serveSocket(Path.of(socketPath));
+        }
+    }
+
+    /**
+     * Map a generated pair a few times so the hot paths are compiled before the first request.
+     */
+    public void warmUp(int runs) throws IOException {
+        if (runs <= 0) {
+            return;
+        }
+        Path dir = Files.createTempDirectory("mapping-warmup");
+        Path oldPath = dir.resolve("Old.java");
+        Path newPath = dir.resolve("New.java");
+        try {
+            List<String> oldLines = new ArrayList<>();
+            List<String> newLines = new ArrayList<>();
+            for (int i = 0; i < 400; i++) {
+                String line = "    int value" + (i % 37) + " = compute(item" + i + ", offset + " + (i % 11) + ");";
+                oldLines.add(line);
+                if (i % 9 == 0) {
+                    newLines.add(line.replace("compute", "computeFast")); // modified
+                } else if (i % 13 != 0) {
+                    newLines.add(line);                                   // unchanged (every 13th deleted)
+                }
+            }
+            Files.write(oldPath, oldLines);
+            Files.write(newPath, newLines);
+
+            MappingOptions options = newOptions(null);
+            for (int i = 0; i < runs; i++) {
+                Preprocessor preprocessor = LineMappingTool.newPreprocessor(options);
+                FileVersion oldFile = preprocessor.loadFile(oldPath.toString());
+                FileVersion newFile = preprocessor.loadFile(newPath.toString());
+                new LineMappingTool().map(oldFile, newFile, options);
+            }
+        } finally {
+            Files.deleteIfExists(oldPath);
+            Files.deleteIfExists(newPath);
+            Files.deleteIfExists(dir);
+        }
+    }
+
+    /**
+     * Requests on stdin, responses on stdout. Returns once stdin is closed (or a shutdown
+     * request came in) and every accepted request has been answered.
+     */
+    public void serveStdio() throws IOException, InterruptedException {
+        Writer out = new BufferedWriter(new OutputStreamWriter(System.out, StandardCharsets.UTF_8));
+        readRequests(System.in, out);
+        workers.shutdown();
+        workers.awaitTermination(Long.MAX_VALUE, TimeUnit.DAYS);
+        out.flush();
+    }
+
+    /**
+     * Listen on a Unix domain socket, one reader thread per connection.
+     * Runs until a shutdown request comes in on any connection.
+     */
+    public void serveSocket(Path socketPath) throws IOException, InterruptedException {
+        Files.deleteIfExists(socketPath); // left over from a server that was killed
+        ServerSocketChannel serverChannel = ServerSocketChannel.open(StandardProtocolFamily.UNIX);
+        try {
+            bindOwnerOnly(serverChannel, socketPath);
+        } catch (IOException | RuntimeException ex) {
+            serverChannel.close();
+            throw ex;
+        }
+        System.err.println("MappingServer listening on " + socketPath);
+
+        try {
+            while (!shuttingDown) {
+                SocketChannel channel;
+                try {
+                    channel = serverChannel.accept();
+                } catch (IOException ex) {
+                    if (shuttingDown) break; // closed by a shutdown request
+                    throw ex;
+                }
+                Thread connection = new Thread(() -> serveConnection(channel, serverChannel));
+                connection.setDaemon(true);
+                connection.start();
+            }
+        } finally {
+            serverChannel.close();
+            Files.deleteIfExists(socketPath);
+            workers.shutdown();
+            workers.awaitTermination(Long.MAX_VALUE, TimeUnit.DAYS);
+        }
+    }
+
+    // ----- helpers -----
+
+    // bind the socket so only our user can connect (see "Trust model" above): bind it in
+    // a fresh 0700 directory next to socketPath, make it 0600, then rename it into place
+    private static void bindOwnerOnly(ServerSocketChannel serverChannel, Path socketPath) throws IOException {
+        if (!FileSystems.getDefault().supportedFileAttributeViews().contains("posix")) {
+            // no POSIX permissions (Windows): the socket gets the folder's ACLs
+            System.err.println("warning: cannot restrict " + socketPath + " to this user, keep its folder private");
+            serverChannel.bind(UnixDomainSocketAddress.of(socketPath));
+            return;
+        }
+        Path parent = socketPath.toAbsolutePath().getParent();
+        Path privateDir = Files.createTempDirectory(parent, ".mapping-server",
+                PosixFilePermissions.asFileAttribute(PosixFilePermissions.fromString("rwx------")));
+        Path bound = privateDir.resolve("socket");
+        try {
+            serverChannel.bind(UnixDomainSocketAddress.of(bound));
+            Files.setPosixFilePermissions(bound, PosixFilePermissions.fromString("rw-------"));
+            Files.move(bound, socketPath, StandardCopyOption.ATOMIC_MOVE);
+        } finally {
+            Files.deleteIfExists(bound);
+            Files.deleteIfExists(privateDir);
+        }
+    }
+
+    private void serveConnection(SocketChannel channel, ServerSocketChannel serverChannel) {
+        try (SocketChannel ch = channel) {
+            InputStream in = Channels.newInputStream(ch);
+            OutputStream rawOut = Channels.newOutputStream(ch);
+            Writer out = new BufferedWriter(new OutputStreamWriter(rawOut, StandardCharsets.UTF_8));
+            List<Future<?>> pending = readRequests(in, out);
+            // answer everything this client sent before closing its socket
+            for (Future<?> future : pending) {
+                future.get();
+            }
+            if (shuttingDown) {
+                serverChannel.close(); // wakes up accept() in serveSocket
+            }
+        } catch (Exception ex) {
+            System.err.println("Connection failed: " + ex);
+        }
+    }
+
+    // reads requests until EOF or shutdown, hands mapping work to the pool;
+    // returns the futures of the requests it submitted
+    private List<Future<?>> readRequests(InputStream in, Writer out) throws IOException {
+        List<Future<?>> pending = new ArrayList<>();
+        BufferedReader reader = new BufferedReader(new InputStreamReader(in, StandardCharsets.UTF_8));
+        String line;
+        while (!shuttingDown && (line = reader.readLine()) != null) {
+            if (line.isBlank()) {
+                continue;
+            }
+            long received = System.nanoTime();
+
+            Map<String, Object> request;
+            try {
+                Object parsed = Json.parse(line);
+                if (!(parsed instanceof Map)) {
+                    throw new IllegalArgumentException("request must be a JSON object");
+                }
+                @SuppressWarnings("unchecked")
+                Map<String, Object> asMap = (Map<String, Object>) parsed;
+                request = asMap;
+            } catch (IllegalArgumentException ex) {
+                failed.incrementAndGet();
+                respond(out, "{\"id\":null,\"ok\":false,\"error\":" + Json.quote(ex.getMessage()) + "}");
+                continue;
+            }
+
+            Object cmd = request.get("cmd");
+            if ("shutdown".equals(cmd)) {
+                shuttingDown = true;
+                respond(out, "{\"ok\":true,\"cmd\":\"shutdown\"}");
+                break;
+            }
+            if ("stats".equals(cmd)) {
+                respond(out, statsJson());
+                continue;
+            }
+
+            try {
+                if (shuttingDown) {
+                    throw new RejectedExecutionException("shutting down");
+                }
+                pending.add(workers.submit(() -> respond(out, handle(request, received))));
+            } catch (RejectedExecutionException ex) { // another connection sent "shutdown"
+                failed.incrementAndGet();
+                respond(out, "{\"id\":" + toJson(request.get("id")) + ",\"ok\":false,\"error\":\"shutting down\"}");
+            }
+        }
+        return pending;
+    }
+
+    // one mapping request -> one response line; never throws
+    private String handle(Map<String, Object> request, long received) {
+        long started = System.nanoTime();
+        String id = toJson(request.get("id"));
+        try {
+            Object oldPath = request.get("old");
+            Object newPath = request.get("new");
+            if (!(oldPath instanceof String) || !(newPath instanceof String)) {
+                throw new IllegalArgumentException("\"old\" and \"new\" paths are required");
+            }
+            MappingOptions options = newOptions(request.get("options"));
+
+            // Preprocessor + tool per request: both keep per-run state
+            Preprocessor preprocessor = LineMappingTool.newPreprocessor(options);
+            FileVersion oldFile = preprocessor.loadFile((String) oldPath);
+            FileVersion newFile = preprocessor.loadFile((String) newPath);
+            List<MappingEntry> mapping = new LineMappingTool().map(oldFile, newFile, options);
+
+            StringBuilder sb = new StringBuilder(64 + 16 * mapping.size());
+            sb.append("{\"id\":").append(id).append(",\"ok\":true")
+              .append(",\"oldLines\":").append(oldFile.getLines().size())
+              .append(",\"newLines\":").append(newFile.getLines().size());
+
+            Object outPath = request.get("out");
+            if (outPath instanceof String) {
+                new MappingWriter(MappingFormat.of(options.getOutputFormat())).writeMapping((String) outPath, mapping);
+            }
+
+            long done = System.nanoTime();
+            served.incrementAndGet();
+            totalLatencyNanos.addAndGet(done - received);
+            sb.append(",\"queueMs\":").append(millis(started - received))
+              .append(",\"latencyMs\":").append(millis(done - received));
+
+            if (outPath instanceof String) {
+                sb.append(",\"out\":").append(Json.quote((String) outPath));
+            } else {
+                sb.append(",\"mapping\":[");
+                for (int i = 0; i < mapping.size(); i++) {
+                    MappingEntry entry = mapping.get(i);
+                    if (i > 0) sb.append(',');
+                    sb.append('[').append(entry.oldLine).append(',').append(entry.newLine);
+                    if (entry.isSplit()) sb.append(',').append(entry.newLineEnd); // [old,new,newEnd]
+                    sb.append(']');
+                }
+                sb.append(']');
+            }
+            return sb.append('}').toString();
+        } catch (Exception ex) {
+            failed.incrementAndGet();
+            return "{\"id\":" + id + ",\"ok\":false,\"error\":" + Json.quote(String.valueOf(ex.getMessage()))
+                    + ",\"latencyMs\":" + millis(System.nanoTime() - received) + "}";
+        }
+    }
+
+    // server flags first, then the request's "options" object as "--key=value" flags
+    private MappingOptions newOptions(Object requestOptions) {
+        MappingOptions options = new MappingOptions();
+        for (String flag : baseFlags) {
+            options.applyFlag(flag);
+        }
+        if (requestOptions == null) {
+            return options;
+        }
+        if (!(requestOptions instanceof Map)) {
+            throw new IllegalArgumentException("\"options\" must be a JSON object");
+        }
+        for (Map.Entry<?, ?> e : ((Map<?, ?>) requestOptions).entrySet()) {
+            String flag = "--" + e.getKey() + "=" + optionValue(e.getValue());
+            if (!options.applyFlag(flag)) {
+                throw new IllegalArgumentException("unknown option or bad value: " + e.getKey());
+            }
+        }
+        return options;
+    }
+
+    // JSON numbers come back as Double; write whole numbers without ".0" so int flags parse
+    private static String optionValue(Object value) {
+        if (value instanceof Double) {
+            double d = (Double) value;
+            if (d == Math.rint(d) && Math.abs(d) < 1e15) {
+                return Long.toString((long) d);
+            }
+        }
+        return String.valueOf(value);
+    }
+
+    private static String toJson(Object value) {
+        if (value == null) {
+            return "null";
+        }
+        if (value instanceof String) {
+            return Json.quote((String) value);
+        }
+        if (value instanceof Double || value instanceof Boolean) {
+            return optionValue(value);
+        }
+        return Json.quote(String.valueOf(value)); // objects/arrays as ids: echo them as text
+    }
+
+    private String statsJson() {
+        long n = served.get();
+        return "{\"ok\":true,\"cmd\":\"stats\",\"served\":" + n
+                + ",\"failed\":" + failed.get()
+                + ",\"meanLatencyMs\":" + (n == 0 ? "0" : millis(totalLatencyNanos.get() / n)) + "}";
+    }
+
+    private static String millis(long nanos) {
+        return String.format(Locale.ROOT, "%.3f", nanos / 1e6);
+    }
+
+    // responses from several workers share one stream, so whole lines go out under a lock
+    private static void respond(Writer out, String json) {
+        synchronized (out) {
+            try {
+                out.write(json);
+                out.write('\n');
+                out.flush();
+            } catch (IOException ex) {
+                System.err.println("Could not send response: " + ex);
+            }
+        }
+    }
+}
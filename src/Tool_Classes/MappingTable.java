@@ -0,0 +1,114 @@
+package tool;
+
+
+import java.util.Arrays;
+import java.util.List;
+
+/**
+ * A finished mapping as plain arrays indexed by old line, which is what the writers
+ * (MappingFormat) walk. Building it places every entry at its old line, so nothing
+ * is sorted and no per-line objects are kept.
+ *
+ * A split old line maps to the new lines getNewLine .. getNewLineEnd (Step 5);
+ * for every other line the two are the same.
+ *
+ * Status is one byte per line (UNCHANGED, MODIFIED_MINOR, MODIFIED, DELETED); old lines
+ * that had no entry are ABSENT and are not written.
+ */
+public final class MappingTable {
+
+    public static final byte UNCHANGED = 0;
+    public static final byte MODIFIED_MINOR = 1;
+    public static final byte MODIFIED = 2;
+    public static final byte DELETED = 3;
+    public static final byte ABSENT = (byte) 0xFF;
+
+    private static final String[] STATUS_NAMES = {"unchanged", "modified(minor)", "modified", "deleted"};
+
+    private final int[] newLines;   // [oldLine - 1] -> new line, -1 = deleted
+    private final int[] newLineEnds; // [oldLine - 1] -> last new line of a split group, else = newLines
+    private final byte[] statuses;  // [oldLine - 1]
+    private final float[] scores;   // [oldLine - 1], NaN = unknown
+
+    public MappingTable(int[] newLines, int[] newLineEnds, byte[] statuses, float[] scores) {
+        this.newLines = newLines;
+        this.newLineEnds = newLineEnds;
+        this.statuses = statuses;
+        this.scores = scores;
+    }
+
+    /**
+     * Table of a MappingEntry list in any order. Entries without an old line ("added") are dropped.
+     */
+    public static MappingTable of(List<MappingEntry> entries) {
+        int size = 0;
+        for (MappingEntry entry : entries) size = Math.max(size, entry.oldLine);
+
+        int[] newLines = new int[size];
+        int[] newLineEnds = new int[size];
+        byte[] statuses = new byte[size];
+        float[] scores = new float[size];
+        Arrays.fill(newLines, -1);
+        Arrays.fill(newLineEnds, -1);
+        Arrays.fill(statuses, ABSENT);
+        Arrays.fill(scores, Float.NaN);
+        for (MappingEntry entry : entries) {
+            if (entry.oldLine <= 0) {
+                continue;
+            }
+            int i = entry.oldLine - 1;
+            newLines[i] = entry.newLine;
+            newLineEnds[i] = Math.max(entry.newLine, entry.newLineEnd);
+            // a line with a new line is never "deleted", whatever the label says
+            statuses[i] = entry.newLine == -1 ? DELETED : (byte) Math.min(statusCode(entry.status), MODIFIED);
+            scores[i] = (float) entry.score;
+        }
+        return new MappingTable(newLines, newLineEnds, statuses, scores);
+    }
+
+    /**
+     * Number of old lines (the highest old line number).
+     */
+    public int size() {
+        return newLines.length;
+    }
+
+    public boolean has(int oldLine) {
+        return statuses[oldLine - 1] != ABSENT;
+    }
+
+    public int getNewLine(int oldLine) {
+        return newLines[oldLine - 1];
+    }
+
+    public int getNewLineEnd(int oldLine) {
+        return newLineEnds[oldLine - 1];
+    }
+
+    public boolean isSplit(int oldLine) {
+        return newLineEnds[oldLine - 1] > newLines[oldLine - 1];
+    }
+
+    public byte getStatusCode(int oldLine) {
+        return statuses[oldLine - 1];
+    }
+
+    public String getStatus(int oldLine) {
+        return statusName(statuses[oldLine - 1]);
+    }
+
+    public float getScore(int oldLine) {
+        return scores[oldLine - 1];
+    }
+
+    static byte statusCode(String status) {
+        for (byte code = 0; code < STATUS_NAMES.length; code++) {
+            if (STATUS_NAMES[code].equals(status)) return code;
+        }
+        return MODIFIED; // anything else that still has a new line
+    }
+
+    static String statusName(byte code) {
+        return code >= 0 && code < STATUS_NAMES.length ? STATUS_NAMES[code] : "absent";
+    }
+}
@@ -0,0 +1,156 @@
+package tool;
+
+
+import java.util.*;
+
+/**
+ * Step 3 (alternative): CANDIDATES FROM MINHASH + LOCALITY-SENSITIVE HASHING
+ *
+ * For huge generated files (schemas, lockfiles, SQL dumps) a few tokens appear on
+ * almost every line, so even the inverted index walks long postings. Here:
+ *   - every line gets a MinHash signature of bands x rows values (one per hash function,
+ *     the minimum hash over the line's tokens); two lines agree on a value with
+ *     probability equal to their token Jaccard,
+ *   - the signature is cut into bands of rows values, each band is hashed to a bucket,
+ *   - new lines that share at least one bucket with an old line are its candidates,
+ *     ranked by how many bands matched (top-k).
+ *
+ * Lookup is a few hash map probes per old line. More rows per band = fewer, more similar
+ * candidates (faster, lower recall); more bands = more chances to collide (higher recall).
+ * measureRecall compares the result against another candidate source (e.g. the window).
+ */
+public class MinHashCandidateGenerator implements CandidateSource {
+
+    private final int bands;         // number of LSH bands
+    private final int rows;          // signature values per band
+    private final int topK;          // max candidates per old line
+    private final int maxBucketSize; // skip buckets bigger than this (lines like "}" all collide)
+
+    public MinHashCandidateGenerator(int bands, int rows, int topK, int maxBucketSize) {
+        this.bands = bands;
+        this.rows = rows;
+        this.topK = topK;
+        this.maxBucketSize = maxBucketSize;
+    }
+
+    @Override
+    public Map<Integer, List<Integer>> generateCandidates(FileVersion oldFile,
+                                                          FileVersion newFile,
+                                                          Set<Integer> unmatchedOldLines,
+                                                          Set<Integer> unmatchedNewLines) {
+        Map<Integer, List<Integer>> candidates = new HashMap<>();
+        long[] tokenHashes = newFile.getDictionary().getTokenHashes();
+        long[] signature = new long[bands * rows];
+
+        int[] newLines = InvertedIndexCandidateGenerator.sorted(unmatchedNewLines); // local index -> line number
+
+        // band key -> local indexes of the new lines in that bucket (ascending)
+        Map<Long, Bucket> buckets = new HashMap<>();
+        for (int local = 0; local < newLines.length; local++) {
+            int[] tokens = getLine(newFile, newLines[local]).getTokenIds();
+            if (tokens.length == 0) continue; // nothing to hash
+            signature(tokens, tokenHashes, signature);
+            for (int b = 0; b < bands; b++) {
+                buckets.computeIfAbsent(bandKey(signature, b), k -> new Bucket()).add(local);
+            }
+        }
+
+        int[] hits = new int[newLines.length]; // matching bands per local new line
+        int[] touched = new int[newLines.length];
+
+        for (int oldLine : InvertedIndexCandidateGenerator.sorted(unmatchedOldLines)) {
+            int[] tokens = getLine(oldFile, oldLine).getTokenIds();
+            if (tokens.length == 0) {
+                candidates.put(oldLine, new ArrayList<>());
+                continue;
+            }
+            signature(tokens, tokenHashes, signature);
+
+            int touchedCount = 0;
+            for (int b = 0; b < bands; b++) {
+                Bucket bucket = buckets.get(bandKey(signature, b));
+                if (bucket == null || bucket.size > maxBucketSize) continue;
+                for (int i = 0; i < bucket.size; i++) {
+                    int local = bucket.lines[i];
+                    if (hits[local]++ == 0) {
+                        touched[touchedCount++] = local;
+                    }
+                }
+            }
+
+            candidates.put(oldLine, InvertedIndexCandidateGenerator.topCandidates(
+                    oldLine, hits, touched, touchedCount, newLines, topK));
+
+            for (int i = 0; i < touchedCount; i++) {
+                hits[touched[i]] = 0;
+            }
+        }
+
+        return candidates;
+    }
+
+    /**
+     * Share of the (old, new) pairs in reference that also appear in candidates.
+     * 1.0 when the reference has no pairs.
+     */
+    public static double measureRecall(Map<Integer, List<Integer>> candidates,
+                                       Map<Integer, List<Integer>> reference) {
+        long total = 0;
+        long found = 0;
+        for (Map.Entry<Integer, List<Integer>> entry : reference.entrySet()) {
+            Set<Integer> ours = new HashSet<>(candidates.getOrDefault(entry.getKey(), List.of()));
+            for (int newLine : entry.getValue()) {
+                total++;
+                if (ours.contains(newLine)) found++;
+            }
+        }
+        return total == 0 ? 1.0 : (double) found / total;
+    }
+
+    // ----- helpers -----
+
+    // signature[i] = min over tokens of hash function i
+    private void signature(int[] tokens, long[] tokenHashes, long[] signature) {
+        Arrays.fill(signature, Long.MAX_VALUE);
+        for (int id : tokens) {
+            long h = tokenHashes[id];
+            for (int i = 0; i < signature.length; i++) {
+                long v = mix(h + (i + 1) * 0x9e3779b97f4a7c15L); // i-th hash function
+                if (v < signature[i]) signature[i] = v;
+            }
+        }
+    }
+
+    private long bandKey(long[] signature, int band) {
+        long key = band;
+        for (int r = band * rows; r < (band + 1) * rows; r++) {
+            key = mix(key * 31 + signature[r]);
+        }
+        return key;
+    }
+
+    // MurmurHash3 64-bit finalizer
+    private static long mix(long h) {
+        h ^= h >>> 33;
+        h *= 0xff51afd7ed558ccdL;
+        h ^= h >>> 33;
+        h *= 0xc4ceb9fe1a85ec53L;
+        h ^= h >>> 33;
+        return h;
+    }
+
+    private LineRecord getLine(FileVersion file, int lineNumber) {
+        return file.getLines().get(lineNumber - 1);
+    }
+
+    // growable int list for one LSH bucket
+    private static class Bucket {
+        int[] lines = new int[4];
+        int size;
+
+        void add(int line) {
+            if (size == lines.length) lines = Arrays.copyOf(lines, size * 2);
+            lines[size++] = line;
+        }
+    }
+}
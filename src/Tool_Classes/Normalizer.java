@@ -0,0 +1,338 @@
+package tool;
+
+
+import java.util.Locale;
+
+/**
+ * Step 1 normalization in one pass, without regex:
+ *   - drop comments (per language, see Profile)
+ *   - trim, and collapse every run of whitespace into one space
+ *   - lowercase
+ *
+ * Replaces trim().replaceAll("\\s+", " ").toLowerCase(), which built three Strings and
+ * ran the regex engine for every line. Here the result goes into a reused char buffer.
+ * A comment counts as whitespace, so "a" + block comment + "b" becomes "a b".
+ * A line that is nothing but comment keeps its text (whitespace collapsed, lowercased,
+ * comment markers and all) instead of becoming "": otherwise every comment-only line
+ * would equal every blank line and every other comment-only line, and Step 2 would
+ * anchor them to each other as unchanged whatever the comment says.
+ *
+ * Block comments (and multi-line strings, so a "//" or "#" inside them is not taken as
+ * a comment) can span lines, so a Normalizer is fed the lines of one file in order and
+ * carries that state from one line to the next (getState / setState).
+ * Lowercasing is per char (Character.toLowerCase), which equals String.toLowerCase
+ * except for a few special characters like the dotted capital I.
+ */
+public final class Normalizer {
+
+    /**
+     * Comment and string syntax of a family of languages (the ones in file_mapping/).
+     */
+    public enum Profile {
+        /** C, C++, Java, JavaScript (incl. `template` strings): line and block comments */
+        C_LIKE("//", true, "\"'", true, false),
+        /** Python: # comments, """ and ''' strings may span lines */
+        PYTHON("#", false, "\"'", false, true),
+        /** CSS: only block comments */
+        CSS(null, true, "\"'", false, false),
+        /** JSON has no comments, only strings to skip */
+        JSON(null, false, "\"", false, false),
+        /** anything else: nothing stripped (the old behaviour) */
+        PLAIN(null, false, "", false, false);
+
+        final String lineComment;     // null = none
+        final boolean blockComments;  // /* ... */
+        final String quotes;          // chars that open a one-line string
+        final boolean backtickStrings;
+        final boolean tripleQuotes;
+
+        Profile(String lineComment, boolean blockComments, String quotes,
+                boolean backtickStrings, boolean tripleQuotes) {
+            this.lineComment = lineComment;
+            this.blockComments = blockComments;
+            this.quotes = quotes;
+            this.backtickStrings = backtickStrings;
+            this.tripleQuotes = tripleQuotes;
+        }
+    }
+
+    // what we are inside of at the end of a line
+    static final byte CODE = 0;
+    static final byte BLOCK_COMMENT = 1;
+    static final byte TRIPLE_DOUBLE = 2;  // """
+    static final byte TRIPLE_SINGLE = 3;  // '''
+    static final byte BACKTICK = 4;       // `...`
+
+    // one scratch Normalizer per thread for LineRecords that normalize lazily
+    private static final ThreadLocal<Normalizer> SCRATCH =
+            ThreadLocal.withInitial(() -> new Normalizer(Profile.PLAIN));
+
+    private Profile profile;
+    private byte state = CODE;
+    private char[] input = new char[256];
+    private char[] buffer = new char[256];
+
+    public Normalizer(Profile profile) {
+        this.profile = profile;
+    }
+
+    /**
+     * Profile from the file extension; unknown extensions get PLAIN.
+     */
+    public static Profile profileFor(String fileName) {
+        int dot = fileName.lastIndexOf('.');
+        String ext = dot < 0 ? "" : fileName.substring(dot + 1).toLowerCase(Locale.ROOT);
+        switch (ext) {
+            case "c": case "h": case "cc": case "cpp": case "hpp": case "cs":
+            case "java": case "js": case "jsx": case "ts": case "tsx":
+            case "go": case "kt": case "scala": case "swift":
+                return Profile.C_LIKE;
+            case "py":
+                return Profile.PYTHON;
+            case "css":
+                return Profile.CSS;
+            case "json":
+                return Profile.JSON;
+            default:
+                return Profile.PLAIN;
+        }
+    }
+
+    /**
+     * Normalize one line given the state at its start (as saved by getState while loading).
+     * Safe from any thread; used for LineRecord.getNormalizedText.
+     */
+    public static String normalizeLine(Profile profile, byte startState, String line) {
+        Normalizer normalizer = SCRATCH.get();
+        normalizer.profile = profile;
+        normalizer.state = startState;
+        int length = normalizer.normalize(line);
+        return new String(normalizer.buffer, 0, length);
+    }
+
+    public Profile getProfile() {
+        return profile;
+    }
+
+    /**
+     * Multi-line state at the end of the last line (CODE, BLOCK_COMMENT, ...).
+     */
+    public byte getState() {
+        return state;
+    }
+
+    public void setState(byte state) {
+        this.state = state;
+    }
+
+    /**
+     * The normalized chars of the last line; only valid until the next call.
+     */
+    public char[] getBuffer() {
+        return buffer;
+    }
+
+    /**
+     * Normalize the next line of the file into getBuffer().
+     *
+     * @return number of chars written
+     */
+    public int normalize(String line) {
+        int length = line.length();
+        if (length > input.length) input = new char[Math.max(length, input.length * 2)];
+        line.getChars(0, length, input, 0);
+        return normalize(input, length);
+    }
+
+    /**
+     * Normalize line index of a mapped file; ASCII lines are read from the bytes directly.
+     */
+    public int normalize(MappedLines text, int index) {
+        int start = text.lineStart(index);
+        int length = text.lineEnd(index) - start;
+        if (length > input.length) input = new char[Math.max(length, input.length * 2)];
+        for (int i = 0; i < length; i++) {
+            byte b = text.byteAt(start + i);
+            if (b < 0) { // multi-byte UTF-8 char: decode the whole line properly
+                return normalize(text.getLine(index));
+            }
+            input[i] = (char) b;
+        }
+        return normalize(input, length);
+    }
+
+    /**
+     * Normalize line[0 .. length) into getBuffer().
+     * The output is never longer than the input (a space is only written for skipped chars).
+     */
+    public int normalize(char[] line, int length) {
+        if (length > buffer.length) buffer = new char[Math.max(length, buffer.length * 2)];
+        int n = stripped(line, length);
+        if (n == 0 && profile != Profile.PLAIN) {
+            n = commentOnly(line, length); // 0 for a blank line
+        }
+        return n;
+    }
+
+    // the comment/string aware pass of normalize, updates state
+    private int stripped(char[] line, int length) {
+        char[] out = buffer;
+        int n = 0;
+        boolean pendingSpace = false; // saw whitespace (or a comment) since the last written char
+
+        int i = 0;
+        while (i < length) {
+            char c = line[i];
+
+            // ----- inside something that started on an earlier line / earlier in this line -----
+            if (state == BLOCK_COMMENT) {
+                int close = indexOf(line, i, length, '*', '/');
+                if (close < 0) {
+                    i = length;
+                } else {
+                    i = close + 2;
+                    state = CODE;
+                }
+                pendingSpace = true;
+                continue;
+            }
+            if (state != CODE) { // multi-line string: keep its text
+                char quote = state == TRIPLE_DOUBLE ? '"' : state == TRIPLE_SINGLE ? '\'' : '`';
+                int width = state == BACKTICK ? 1 : 3;
+                if (c == '\\' && i + 1 < length) {
+                    n = emit(out, n, c, pendingSpace);
+                    n = emit(out, n, line[i + 1], false);
+                    pendingSpace = false;
+                    i += 2;
+                    continue;
+                }
+                if (c == quote && (width == 1 || (i + 2 < length && line[i + 1] == quote && line[i + 2] == quote))) {
+                    for (int k = 0; k < width; k++) {
+                        n = emit(out, n, quote, pendingSpace && k == 0);
+                    }
+                    pendingSpace = false;
+                    i += width;
+                    state = CODE;
+                    continue;
+                }
+                if (c <= ' ') {
+                    pendingSpace = true;
+                } else {
+                    n = emit(out, n, c, pendingSpace);
+                    pendingSpace = false;
+                }
+                i++;
+                continue;
+            }
+
+            // ----- plain code -----
+            if (c <= ' ') {
+                pendingSpace = true;
+                i++;
+                continue;
+            }
+            if (profile.lineComment != null && startsWith(line, i, length, profile.lineComment)) {
+                pendingSpace = true;
+                break; // rest of the line is a comment
+            }
+            if (profile.blockComments && c == '/' && i + 1 < length && line[i + 1] == '*') {
+                state = BLOCK_COMMENT;
+                pendingSpace = true;
+                i += 2;
+                continue;
+            }
+            if (profile.tripleQuotes && (c == '"' || c == '\'')
+                    && i + 2 < length && line[i + 1] == c && line[i + 2] == c) {
+                n = emit(out, n, c, pendingSpace);
+                n = emit(out, n, c, false);
+                n = emit(out, n, c, false);
+                pendingSpace = false;
+                state = c == '"' ? TRIPLE_DOUBLE : TRIPLE_SINGLE;
+                i += 3;
+                continue;
+            }
+            if (profile.backtickStrings && c == '`') {
+                n = emit(out, n, c, pendingSpace);
+                pendingSpace = false;
+                state = BACKTICK;
+                i++;
+                continue;
+            }
+            if (profile.quotes.indexOf(c) >= 0) {
+                // one-line string: copy up to the closing quote (or the end of the line)
+                n = emit(out, n, c, pendingSpace);
+                pendingSpace = false;
+                i++;
+                while (i < length) {
+                    char s = line[i];
+                    if (s == '\\' && i + 1 < length) {
+                        n = emit(out, n, s, pendingSpace);
+                        n = emit(out, n, line[i + 1], false);
+                        pendingSpace = false;
+                        i += 2;
+                        continue;
+                    }
+                    i++;
+                    if (s <= ' ') {
+                        pendingSpace = true;
+                        continue;
+                    }
+                    n = emit(out, n, s, pendingSpace);
+                    pendingSpace = false;
+                    if (s == c) break;
+                }
+                continue;
+            }
+
+            n = emit(out, n, c, pendingSpace);
+            pendingSpace = false;
+            i++;
+        }
+        return n;
+    }
+
+    // ----- helpers -----
+
+    // the line as PLAIN would normalize it (nothing stripped); state is left alone,
+    // so the next line still knows it is inside a block comment
+    private int commentOnly(char[] line, int length) {
+        int n = 0;
+        boolean pendingSpace = false;
+        for (int i = 0; i < length; i++) {
+            char c = line[i];
+            if (c <= ' ') {
+                pendingSpace = true;
+            } else {
+                n = emit(buffer, n, c, pendingSpace);
+                pendingSpace = false;
+            }
+        }
+        return n;
+    }
+
+    // writes c lowercased, with one space before it if whitespace came first (but never at the start)
+    private static int emit(char[] out, int n, char c, boolean spaceFirst) {
+        if (spaceFirst && n > 0) {
+            out[n++] = ' ';
+        }
+        out[n++] = c >= 'A' && c <= 'Z' ? (char) (c + ('a' - 'A'))
+                : c < 128 ? c : Character.toLowerCase(c);
+        return n;
+    }
+
+    private static boolean startsWith(char[] line, int from, int length, String prefix) {
+        if (from + prefix.length() > length) return false;
+        for (int k = 0; k < prefix.length(); k++) {
+            if (line[from + k] != prefix.charAt(k)) return false;
+        }
+        return true;
+    }
+
+    // first position p >= from with line[p] == a and line[p + 1] == b, or -1
+    private static int indexOf(char[] line, int from, int length, char a, char b) {
+        for (int p = from; p + 1 < length; p++) {
+            if (line[p] == a && line[p + 1] == b) return p;
+        }
+        return -1;
+    }
+}
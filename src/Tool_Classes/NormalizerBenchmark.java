@@ -0,0 +1,101 @@
+package tool;
+
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
+
+/**
+ * Microbenchmark: lines/second of the Normalizer against the old regex normalization
+ * (trim + replaceAll("\\s+", " ") + toLowerCase).
+ *
+ *   java tool.NormalizerBenchmark [--rounds=N] [file or folder ...]    (default: file_mapping)
+ *
+ * Every file is read once; then each version normalizes all lines, a few untimed warmup
+ * rounds first so both are JIT-compiled, then --rounds timed rounds (best round counts).
+ */
+public class NormalizerBenchmark {
+
+    private static final int WARMUP_ROUNDS = 5;
+
+    public static void main(String[] args) throws IOException {
+        int rounds = 10;
+        List<Path> roots = new ArrayList<>();
+        for (String arg : args) {
+            if (arg.startsWith("--rounds=")) {
+                rounds = Integer.parseInt(arg.substring("--rounds=".length()));
+            } else {
+                roots.add(Path.of(arg));
+            }
+        }
+        if (roots.isEmpty()) {
+            roots.add(Path.of("file_mapping"));
+        }
+
+        // per file: its lines and the profile its extension picks
+        List<String[]> files = new ArrayList<>();
+        List<Normalizer.Profile> profiles = new ArrayList<>();
+        long lineCount = 0;
+        for (Path root : roots) {
+            List<Path> paths;
+            try (Stream<Path> walk = Files.walk(root)) {
+                paths = walk.filter(Files::isRegularFile).sorted().collect(Collectors.toList());
+            }
+            for (Path path : paths) {
+                String text = new String(Files.readAllBytes(path), StandardCharsets.UTF_8);
+                String[] lines = text.split("\r\n|\r|\n");
+                files.add(lines);
+                profiles.add(Normalizer.profileFor(path.toString()));
+                lineCount += lines.length;
+            }
+        }
+        if (lineCount == 0) {
+            System.err.println("No lines to normalize.");
+            return;
+        }
+
+        long regexNanos = Long.MAX_VALUE;
+        long singlePassNanos = Long.MAX_VALUE;
+        long sink = 0; // results feed this so the JIT cannot drop the work
+        for (int round = -WARMUP_ROUNDS; round < rounds; round++) {
+            long start = System.nanoTime();
+            for (String[] lines : files) {
+                for (String line : lines) {
+                    sink += regexNormalize(line).length();
+                }
+            }
+            long regex = System.nanoTime() - start;
+
+            start = System.nanoTime();
+            for (int f = 0; f < files.size(); f++) {
+                Normalizer normalizer = new Normalizer(profiles.get(f));
+                for (String line : files.get(f)) {
+                    sink += normalizer.normalize(line);
+                }
+            }
+            long singlePass = System.nanoTime() - start;
+
+            if (round >= 0) {
+                regexNanos = Math.min(regexNanos, regex);
+                singlePassNanos = Math.min(singlePassNanos, singlePass);
+            }
+        }
+
+        System.out.printf("%d files, %d lines (checksum %d)%n", files.size(), lineCount, sink);
+        System.out.printf("regex normalize:       %,.0f lines/s%n", lineCount / (regexNanos / 1e9));
+        System.out.printf("single-pass normalize: %,.0f lines/s (%.1fx, comments stripped)%n",
+                lineCount / (singlePassNanos / 1e9), (double) regexNanos / singlePassNanos);
+    }
+
+    // the Preprocessor's normalization before Normalizer
+    private static String regexNormalize(String line) {
+        return line
+                .trim()
+                .replaceAll("\\s+", " ")
+                .toLowerCase();
+    }
+}
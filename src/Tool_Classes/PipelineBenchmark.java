@@ -0,0 +1,520 @@
+package tool;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Comparator;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.Random;
+import java.util.Set;
+import java.util.stream.Stream;
+
+/**
+ * BENCHMARKS:
+ * Times every pipeline stage on its own plus the whole LineMappingTool.run, so a change to
+ * UnchangedDetector, CandidateGenerator, SimilarityCalculator or Mapper shows up as a number.
+ *
+ * Plain Java instead of JMH: the project has no build system to hang a JMH module on.
+ * We do what JMH would do by hand: untimed warmup iterations first, then timed
+ * iterations, median reported, and every result feeds a sink so the JIT cannot drop it.
+ * Each stage only times itself; its inputs (loaded files, unchanged lines, candidates)
+ * are prepared once per input beforehand.
+ *
+ * Inputs:
+ *  - "file_mapping": all sample pairs under file_mapping/ (SamplePairs), one op = all pairs
+ *  - "synthetic-1k" ... "synthetic-1m": EditGenerator pairs of that many old lines, grown from
+ *    --seed-file (default: the biggest sample file, or built-in Java-like lines without samples)
+ *
+ * The two step4-kernel stages score the same candidate pairs with the SimHash and bitset
+ * kernels, once pair by pair (SimHash.similarity, JaccardKernel.jaccard) and once per
+ * old line against its whole candidate block (similarityBlock, jaccardBlock), so the two
+ * lines/s numbers can be compared. The bitset part only runs when the vocabulary is small
+ * enough for SimilarityCalculator to use bitsets.
+ *
+ * step4-kernel-block runs on BlockKernels.ACTIVE (the Vector API kernels when started with
+ * --add-modules jdk.incubator.vector and src/Tool_Vector compiled, see BlockKernels),
+ * step4-kernel-block-scalar on the scalar loops, so the two show the SIMD speedup:
+ *   java --add-modules jdk.incubator.vector tool.PipelineBenchmark --stages=step4-kernel-block,step4-kernel-block-scalar
+ *
+ * Allocation: every result also has the bytes the stage allocated on the benchmark thread
+ * (median over the timed iterations, AllocationCounter; -1 on JVMs without it).
+ * "step4-similarity-strings" is the pre-interning baseline for "step4-similarity": the same
+ * candidate pairs and the same Jaccard scores, but every pair re-tokenizes its lines and
+ * context with split("\\W+") into String sets, the way SimilarityCalculator did before the
+ * token ids. Run both to see time and bytes before and after interning:
+ *   java tool.PipelineBenchmark --stages=step4-similarity,step4-similarity-strings
+ *
+ * Baseline comparison: --save=<file> writes the results as JSON, --baseline=<file> compares
+ * against such a file and flags every benchmark slower than baseline x (1 + threshold);
+ * the exit code is 1 if anything regressed.
+ *
+ *   java tool.PipelineBenchmark [--sizes=1000,10000,100000,1000000] [--stages=step2-unchanged,...]
+ *        [--warmup=N] [--iterations=N] [--samples=<dir>] [--seed-file=<file>] [--save=<file>] [--baseline=<file>] [--threshold=0.10]
+ */
+public class PipelineBenchmark {
+
+    private static final String[] STAGES = {
+            "step1-preprocess", "step2-unchanged", "step2-diff", "step3-candidates",
+            "step4-similarity", "step4-similarity-strings", "step4-kernel-pairwise", "step4-kernel-block",
+            "step4-kernel-block-scalar", "step4-mapper", "end-to-end"
+    };
+
+    /**
+     * Loaded input for the stage benchmarks: one or more pairs, with everything the
+     * stages need already computed.
+     */
+    static final class Input {
+        final String name;
+        final List<Path[]> paths = new ArrayList<>();            // {old, new}
+        final List<FileVersion[]> files = new ArrayList<>();     // {old, new}
+        final List<Map<Integer, Integer>> unchanged = new ArrayList<>();
+        final List<Set<Integer>[]> unmatched = new ArrayList<>(); // {old, new}
+        final List<Map<Integer, List<Integer>>> candidates = new ArrayList<>();
+        long lines;                                               // old + new lines over all pairs
+
+        Input(String name) {
+            this.name = name;
+        }
+    }
+
+    /**
+     * One timed result.
+     */
+    static final class Result {
+        final String name;      // "<stage>/<input>"
+        final double medianMs;
+        final double linesPerSecond;
+        final long allocatedBytes; // median per op, -1 if the JVM cannot count
+
+        Result(String name, double medianMs, double linesPerSecond, long allocatedBytes) {
+            this.name = name;
+            this.medianMs = medianMs;
+            this.linesPerSecond = linesPerSecond;
+            this.allocatedBytes = allocatedBytes;
+        }
+    }
+
+    private final int warmup;
+    private final int iterations;
+    private final Set<String> stages;
+    private long sink; // every stage adds something here
+
+    public PipelineBenchmark(int warmup, int iterations, Set<String> stages) {
+        this.warmup = warmup;
+        this.iterations = iterations;
+        this.stages = stages;
+    }
+
+    public static void main(String[] args) throws IOException {
+        int[] sizes = {1_000, 10_000, 100_000, 1_000_000};
+        Set<String> stages = new HashSet<>(Arrays.asList(STAGES));
+        int warmup = 3;
+        int iterations = 5;
+        Path samples = Path.of("file_mapping");
+        Path seedFile = null;
+        String save = null;
+        String baseline = null;
+        double threshold = 0.10;
+
+        for (String arg : args) {
+            int eq = arg.indexOf('=');
+            String value = eq < 0 ? "" : arg.substring(eq + 1);
+            if (arg.startsWith("--sizes=")) {
+                sizes = value.isEmpty() ? new int[0]
+                        : Arrays.stream(value.split(",")).mapToInt(s -> Integer.parseInt(s.trim())).toArray();
+            } else if (arg.startsWith("--stages=")) {
+                stages = new HashSet<>(Arrays.asList(value.split(",")));
+            } else if (arg.startsWith("--warmup=")) {
+                warmup = Integer.parseInt(value);
+            } else if (arg.startsWith("--iterations=")) {
+                iterations = Integer.parseInt(value);
+            } else if (arg.startsWith("--samples=")) {
+                samples = value.isEmpty() ? null : Path.of(value);
+            } else if (arg.startsWith("--seed-file=")) {
+                seedFile = Path.of(value);
+            } else if (arg.startsWith("--save=")) {
+                save = value;
+            } else if (arg.startsWith("--baseline=")) {
+                baseline = value;
+            } else if (arg.startsWith("--threshold=")) {
+                threshold = Double.parseDouble(value);
+            } else {
+                System.err.println("Unknown option: " + arg);
+                System.exit(1);
+            }
+        }
+
+        PipelineBenchmark bench = new PipelineBenchmark(warmup, iterations, stages);
+        System.out.println("block kernels: " + BlockKernels.ACTIVE.name());
+        List<Input> inputs = new ArrayList<>();
+        Path tempDir = Files.createTempDirectory("pipeline-bench");
+        try {
+            List<SamplePairs.Pair> samplePairs = new ArrayList<>();
+            if (samples != null && Files.isDirectory(samples)) {
+                samplePairs = SamplePairs.find(samples);
+                Input input = new Input("file_mapping");
+                for (SamplePairs.Pair pair : samplePairs) {
+                    input.paths.add(new Path[]{pair.oldPath, pair.newPath});
+                }
+                inputs.add(input);
+            }
+            List<String> seedLines = seedFile != null ? EditGenerator.readSeed(seedFile) : defaultSeed(samplePairs);
+            for (int size : sizes) {
+                Input input = new Input("synthetic-" + sizeLabel(size));
+                input.paths.add(syntheticPair(tempDir, seedLines, size, 42L + size));
+                inputs.add(input);
+            }
+
+            List<Result> results = new ArrayList<>();
+            for (Input input : inputs) {
+                prepare(input);
+                System.out.printf("%s: %d pair(s), %,d lines%n", input.name, input.paths.size(), input.lines);
+                results.addAll(bench.runAll(input));
+            }
+            System.out.println("(checksum " + bench.sink + ")");
+
+            if (save != null) {
+                Files.writeString(Path.of(save), toJson(results));
+            }
+            if (baseline != null) {
+                boolean regressed = compare(results, readBaseline(Path.of(baseline)), threshold);
+                if (regressed) {
+                    System.exit(1);
+                }
+            }
+        } finally {
+            deleteTree(tempDir);
+        }
+    }
+
+    /**
+     * Run every selected stage on one input.
+     */
+    public List<Result> runAll(Input input) throws IOException {
+        List<Result> results = new ArrayList<>();
+        for (String stage : STAGES) {
+            if (!stages.contains(stage)) {
+                continue;
+            }
+            double[] ms = new double[iterations];
+            long[] bytes = new long[iterations];
+            for (int i = -warmup; i < iterations; i++) {
+                long allocatedBefore = AllocationCounter.currentThreadAllocatedBytes();
+                long start = System.nanoTime();
+                runStage(stage, input);
+                long elapsed = System.nanoTime() - start;
+                if (i >= 0) {
+                    ms[i] = elapsed / 1e6;
+                    bytes[i] = allocatedBefore < 0 ? -1
+                            : AllocationCounter.currentThreadAllocatedBytes() - allocatedBefore;
+                }
+            }
+            Arrays.sort(ms);
+            Arrays.sort(bytes);
+            double median = iterations == 0 ? 0 : ms[iterations / 2];
+            long medianBytes = iterations == 0 ? 0 : bytes[iterations / 2];
+            Result result = new Result(stage + "/" + input.name, median, input.lines / (median / 1000.0), medianBytes);
+            System.out.printf(Locale.ROOT, "  %-40s %10.3f ms  %,14.0f lines/s  %,16d bytes%n",
+                    result.name, result.medianMs, result.linesPerSecond, result.allocatedBytes);
+            results.add(result);
+        }
+        return results;
+    }
+
+    // ----- stages -----
+
+    private void runStage(String stage, Input input) throws IOException {
+        SimilarityCalculator calculator = new SimilarityCalculator(LineMappingTool.CONTEXT_WINDOW);
+        for (int p = 0; p < input.paths.size(); p++) {
+            FileVersion oldFile = input.files.get(p)[0];
+            FileVersion newFile = input.files.get(p)[1];
+            switch (stage) {
+                case "step1-preprocess": {
+                    Preprocessor preprocessor = new Preprocessor(LineMappingTool.CONTEXT_WINDOW);
+                    sink += preprocessor.loadFile(input.paths.get(p)[0].toString()).getLines().size();
+                    sink += preprocessor.loadFile(input.paths.get(p)[1].toString()).getLines().size();
+                    break;
+                }
+                case "step2-unchanged":
+                    sink += new UnchangedDetector().detectUnchanged(oldFile, newFile).size();
+                    break;
+                case "step2-diff":
+                    sink += new DiffAnchorDetector().detectUnchanged(oldFile, newFile).size();
+                    break;
+                case "step3-candidates": {
+                    Set<Integer>[] unmatched = input.unmatched.get(p);
+                    sink += LineMappingTool.windowCandidateGenerator()
+                            .generateCandidates(oldFile, newFile, unmatched[0], unmatched[1]).size();
+                    break;
+                }
+                case "step4-similarity": {
+                    double total = 0;
+                    for (Map.Entry<Integer, List<Integer>> e : input.candidates.get(p).entrySet()) {
+                        for (int newLine : e.getValue()) {
+                            total += calculator.combinedSimilarity(oldFile, e.getKey(), newFile, newLine);
+                        }
+                    }
+                    sink += (long) total;
+                    break;
+                }
+                case "step4-similarity-strings": {
+                    double total = 0;
+                    for (Map.Entry<Integer, List<Integer>> e : input.candidates.get(p).entrySet()) {
+                        for (int newLine : e.getValue()) {
+                            total += stringSimilarity(oldFile, e.getKey(), newFile, newLine);
+                        }
+                    }
+                    sink += (long) total;
+                    break;
+                }
+                case "step4-kernel-pairwise": {
+                    long[][][] bits = contextBits(oldFile, newFile);
+                    double total = 0;
+                    for (Map.Entry<Integer, List<Integer>> e : input.candidates.get(p).entrySet()) {
+                        LineRecord oldLine = oldFile.getLines().get(e.getKey() - 1);
+                        for (int newLine : e.getValue()) {
+                            LineRecord candidate = newFile.getLines().get(newLine - 1);
+                            total += SimHash.similarity(oldLine.getContentSimHash(), candidate.getContentSimHash())
+                                    + SimHash.similarity(oldLine.getContextSimHash(), candidate.getContextSimHash());
+                            if (bits != null) {
+                                total += JaccardKernel.jaccard(bits[0][e.getKey() - 1], bits[1][newLine - 1]);
+                            }
+                        }
+                    }
+                    sink += (long) total;
+                    break;
+                }
+                case "step4-kernel-block":
+                    sink += (long) kernelBlock(BlockKernels.ACTIVE, oldFile, newFile, input.candidates.get(p));
+                    break;
+                case "step4-kernel-block-scalar":
+                    sink += (long) kernelBlock(BlockKernels.SCALAR, oldFile, newFile, input.candidates.get(p));
+                    break;
+                case "step4-mapper": {
+                    Mapper mapper = new Mapper(calculator, LineMappingTool.SIMILARITY_THRESHOLD, true, 3);
+                    sink += mapper.mapLines(oldFile, newFile, input.unchanged.get(p), input.candidates.get(p)).size();
+                    break;
+                }
+                case "end-to-end": {
+                    Path out = Files.createTempFile("bench", ".map.txt");
+                    try {
+                        new LineMappingTool().run(input.paths.get(p)[0].toString(),
+                                input.paths.get(p)[1].toString(), out.toString());
+                        sink += Files.size(out);
+                    } finally {
+                        Files.deleteIfExists(out);
+                    }
+                    break;
+                }
+                default:
+                    throw new IllegalArgumentException("unknown stage " + stage);
+            }
+        }
+    }
+
+    // ----- helpers -----
+
+    // the step4-kernel-block stages: every old line against its candidate block on one set of kernels
+    private static double kernelBlock(BlockKernels kernels, FileVersion oldFile, FileVersion newFile,
+                                      Map<Integer, List<Integer>> candidates) {
+        long[][][] bits = contextBits(oldFile, newFile);
+        long[] content = newFile.getContentSimHashes();
+        long[] context = newFile.getContextSimHashes();
+        int[] block = new int[16];
+        double[] out = new double[16];
+        double total = 0;
+        for (Map.Entry<Integer, List<Integer>> e : candidates.entrySet()) {
+            LineRecord oldLine = oldFile.getLines().get(e.getKey() - 1);
+            int count = e.getValue().size();
+            if (count > block.length) {
+                block = new int[count];
+                out = new double[count];
+            }
+            for (int k = 0; k < count; k++) block[k] = e.getValue().get(k);
+            kernels.similarityBlock(oldLine.getContentSimHash(), content, block, count, out);
+            for (int k = 0; k < count; k++) total += out[k];
+            kernels.similarityBlock(oldLine.getContextSimHash(), context, block, count, out);
+            for (int k = 0; k < count; k++) total += out[k];
+            if (bits != null) {
+                kernels.jaccardBlock(bits[0][e.getKey() - 1], bits[1], block, count, out);
+                for (int k = 0; k < count; k++) total += out[k];
+            }
+        }
+        return total;
+    }
+
+    // combinedSimilarity as it was before the token ids: tokenize both lines and both
+    // context windows again for every pair (the step4-similarity-strings baseline)
+    private static double stringSimilarity(FileVersion oldFile, int oldLineNum, FileVersion newFile, int newLineNum) {
+        double content = stringJaccard(stringTokens(oldFile, oldLineNum, 0), stringTokens(newFile, newLineNum, 0));
+        double context = stringJaccard(stringTokens(oldFile, oldLineNum, LineMappingTool.CONTEXT_WINDOW),
+                stringTokens(newFile, newLineNum, LineMappingTool.CONTEXT_WINDOW));
+        return 0.6 * content + 0.4 * context;
+    }
+
+    private static Set<String> stringTokens(FileVersion file, int centerLine, int window) {
+        int start = Math.max(1, centerLine - window);
+        int end = Math.min(file.getLines().size(), centerLine + window);
+        Set<String> tokens = new HashSet<>();
+        for (int lineNum = start; lineNum <= end; lineNum++) {
+            String text = file.getLines().get(lineNum - 1).getNormalizedText();
+            if (text == null || text.isBlank()) {
+                continue;
+            }
+            Arrays.stream(text.split("\\W+")).filter(s -> !s.isBlank()).forEach(tokens::add);
+        }
+        return tokens;
+    }
+
+    private static double stringJaccard(Set<String> a, Set<String> b) {
+        if (a.isEmpty() && b.isEmpty()) {
+            return 1.0;
+        }
+        Set<String> intersection = new HashSet<>(a);
+        intersection.retainAll(b);
+        Set<String> union = new HashSet<>(a);
+        union.addAll(b);
+        return union.isEmpty() ? 0.0 : (double) intersection.size() / union.size();
+    }
+
+    // {old, new} context bitsets, or null when the vocabulary is too big for bitsets
+    private static long[][][] contextBits(FileVersion oldFile, FileVersion newFile) {
+        ContextTokens contextOld = oldFile.getContextTokens(LineMappingTool.CONTEXT_WINDOW);
+        ContextTokens contextNew = newFile.getContextTokens(LineMappingTool.CONTEXT_WINDOW);
+        if (contextOld.getTokenIdLimit() > SimilarityCalculator.BITSET_MAX_TOKENS
+                || contextNew.getTokenIdLimit() > SimilarityCalculator.BITSET_MAX_TOKENS) {
+            return null;
+        }
+        return new long[][][]{contextOld.getBits(), contextNew.getBits()};
+    }
+
+    // load every pair and compute what the later stages start from
+    private static void prepare(Input input) throws IOException {
+        for (Path[] pair : input.paths) {
+            Preprocessor preprocessor = new Preprocessor(LineMappingTool.CONTEXT_WINDOW);
+            FileVersion oldFile = preprocessor.loadFile(pair[0].toString());
+            FileVersion newFile = preprocessor.loadFile(pair[1].toString());
+            Map<Integer, Integer> unchanged = new UnchangedDetector().detectUnchanged(oldFile, newFile);
+
+            Set<Integer> unmatchedOld = new HashSet<>();
+            for (int i = 1; i <= oldFile.getLines().size(); i++) {
+                if (!unchanged.containsKey(i)) unmatchedOld.add(i);
+            }
+            Set<Integer> usedNew = new HashSet<>(unchanged.values());
+            Set<Integer> unmatchedNew = new HashSet<>();
+            for (int i = 1; i <= newFile.getLines().size(); i++) {
+                if (!usedNew.contains(i)) unmatchedNew.add(i);
+            }
+            @SuppressWarnings("unchecked")
+            Set<Integer>[] unmatched = new Set[]{unmatchedOld, unmatchedNew};
+
+            input.files.add(new FileVersion[]{oldFile, newFile});
+            input.unchanged.add(unchanged);
+            input.unmatched.add(unmatched);
+            input.candidates.add(LineMappingTool.windowCandidateGenerator()
+                    .generateCandidates(oldFile, newFile, unmatchedOld, unmatchedNew));
+            input.lines += oldFile.getLines().size() + newFile.getLines().size();
+        }
+    }
+
+    /**
+     * Write an EditGenerator pair with `lines` old lines into dir.
+     */
+    static Path[] syntheticPair(Path dir, List<String> seedLines, int lines, long seed) throws IOException {
+        EditGenerator.Result pair = new EditGenerator().setLines(lines).generate(seedLines, seed);
+        Path[] written = pair.write(dir, "synthetic-" + lines, "java");
+        return new Path[]{written[0], written[1]};
+    }
+
+    /**
+     * Seed for the synthetic inputs: the biggest old file of the sample pairs, or generated
+     * Java-like lines when there are no samples.
+     */
+    static List<String> defaultSeed(List<SamplePairs.Pair> samplePairs) throws IOException {
+        Path biggest = null;
+        for (SamplePairs.Pair pair : samplePairs) {
+            if (biggest == null || Files.size(pair.oldPath) > Files.size(biggest)) biggest = pair.oldPath;
+        }
+        if (biggest != null) {
+            return EditGenerator.readSeed(biggest);
+        }
+
+        Random random = new Random(42);
+        String[] names = {"value", "count", "index", "result", "buffer", "node", "item", "total"};
+        List<String> seedLines = new ArrayList<>();
+        for (int i = 0; i < 500; i++) {
+            String name = names[random.nextInt(names.length)] + random.nextInt(200);
+            seedLines.add("        int " + name + " = compute(" + names[random.nextInt(names.length)]
+                    + ", " + random.nextInt(1000) + ");");
+        }
+        return seedLines;
+    }
+
+    static String toJson(List<Result> results) {
+        StringBuilder sb = new StringBuilder("{\"benchmarks\":[\n");
+        for (int i = 0; i < results.size(); i++) {
+            Result r = results.get(i);
+            sb.append(String.format(Locale.ROOT, "  {\"name\":%s,\"medianMs\":%.4f,\"linesPerSecond\":%.1f,\"allocatedBytes\":%d}",
+                    Json.quote(r.name), r.medianMs, r.linesPerSecond, r.allocatedBytes));
+            sb.append(i + 1 < results.size() ? ",\n" : "\n");
+        }
+        return sb.append("]}\n").toString();
+    }
+
+    // name -> median ms of a file written by --save
+    static Map<String, Double> readBaseline(Path file) throws IOException {
+        Map<String, Double> medians = new LinkedHashMap<>();
+        Object parsed = Json.parse(Files.readString(file));
+        if (!(parsed instanceof Map) || !(((Map<?, ?>) parsed).get("benchmarks") instanceof List)) {
+            throw new IOException("Not a benchmark results file: " + file);
+        }
+        for (Object o : (List<?>) ((Map<?, ?>) parsed).get("benchmarks")) {
+            Map<?, ?> entry = (Map<?, ?>) o;
+            medians.put((String) entry.get("name"), (Double) entry.get("medianMs"));
+        }
+        return medians;
+    }
+
+    /**
+     * Print each result next to its baseline.
+     *
+     * @return true if any benchmark is slower than baseline x (1 + threshold)
+     */
+    static boolean compare(List<Result> results, Map<String, Double> baseline, double threshold) {
+        boolean regressed = false;
+        System.out.printf(Locale.ROOT, "%nBaseline comparison (threshold %.0f%%):%n", threshold * 100);
+        for (Result r : results) {
+            Double before = baseline.get(r.name);
+            if (before == null) {
+                System.out.printf(Locale.ROOT, "  %-40s %10.3f ms  (no baseline)%n", r.name, r.medianMs);
+                continue;
+            }
+            double change = before == 0 ? 0 : (r.medianMs - before) / before;
+            boolean bad = change > threshold;
+            regressed |= bad;
+            System.out.printf(Locale.ROOT, "  %-40s %10.3f ms  vs %10.3f ms  %+7.1f%%%s%n",
+                    r.name, r.medianMs, before, change * 100, bad ? "  REGRESSION" : "");
+        }
+        return regressed;
+    }
+
+    private static String sizeLabel(int size) {
+        if (size % 1_000_000 == 0) return (size / 1_000_000) + "m";
+        if (size % 1_000 == 0) return (size / 1_000) + "k";
+        return Integer.toString(size);
+    }
+
+    static void deleteTree(Path dir) throws IOException {
+        try (Stream<Path> walk = Files.walk(dir)) {
+            for (Path p : walk.sorted(Comparator.reverseOrder()).toArray(Path[]::new)) {
+                Files.deleteIfExists(p);
+            }
+        }
+    }
+}
@@ -0,0 +1,311 @@
+package tool;
+
+
+import java.io.PrintStream;
+import java.util.Locale;
+import java.util.concurrent.atomic.AtomicLongArray;
+import java.util.concurrent.atomic.LongAdder;
+
+import jdk.jfr.Category;
+import jdk.jfr.DataAmount;
+import jdk.jfr.Event;
+import jdk.jfr.Label;
+import jdk.jfr.Name;
+
+/**
+ * Where the time of one mapping run goes: wall time and allocated bytes per stage,
+ * plus counters of what the pipeline did (--stats, --report=<file>, JFR).
+ *
+ * Off by default. A run without --stats / --report and without a JFR recording has no
+ * PipelineMetrics at all (null); call sites check for null, and span() then hands back
+ * one shared no-op Span, so the disabled cost is a null check per stage.
+ *
+ * Wall time is measured on the thread that runs the stage. Work a stage hands to
+ * pool threads (parallel scoring, hunks) adds the allocation of those threads too.
+ * Counters are LongAdders, since hunks and scoring chunks update them in parallel.
+ *
+ * With a JFR recording running, every stage is also a "tool.PipelineStage" event and
+ * the run ends with one "tool.MappingRun" event holding the counters:
+ *   java -XX:StartFlightRecording=filename=run.jfr tool.LineMappingTool old new out
+ */
+public final class PipelineMetrics {
+
+    /**
+     * Timed stages, in pipeline order. With --hunks, Steps 3-4 inside the hunks run
+     * interleaved on a pool and are timed together as HUNKS.
+     */
+    public enum Stage {
+        PREPROCESS("step1-preprocess"),
+        UNCHANGED("step2-unchanged"),
+        CANDIDATES("step3-candidates"),
+        HUNKS("step3-4-hunks"),
+        SCORING("step4-scoring"),
+        ASSIGNMENT("step4-assignment"),
+        SPLITS("step5-splits"),
+        WRITE("step6-write");
+
+        final String label;
+
+        Stage(String label) {
+            this.label = label;
+        }
+    }
+
+    // ----- counters (updated straight from the pipeline classes) -----
+    final LongAdder exactMatches = new LongAdder();        // Step 2 unchanged lines
+    final LongAdder hashCollisions = new LongAdder();      // Step 2 same line id, different text (greedy anchor)
+    final LongAdder candidatesGenerated = new LongAdder(); // Step 3 (old, new) candidate pairs
+    final LongAdder pairsScored = new LongAdder();         // Step 4 pairs run through combinedSimilarity
+    final LongAdder pairsPruned = new LongAdder();         // Step 4 candidate pairs dropped without a score
+    final LongAdder acceptedBelowMinor = new LongAdder();  // matches with score < 0.9 ("modified")
+    final LongAdder acceptedMinor = new LongAdder();       // matches with score >= 0.9 ("modified(minor)")
+    final LongAdder splitGroups = new LongAdder();         // Step 5 old lines that match 2+ new lines
+
+    private final AtomicLongArray wallNanos = new AtomicLongArray(Stage.values().length);
+    private final AtomicLongArray allocatedBytes = new AtomicLongArray(Stage.values().length);
+    private final AtomicLongArray spans = new AtomicLongArray(Stage.values().length);
+    private final long startNanos = System.nanoTime();
+    private final boolean jfr;      // a recording wants our events
+    private final RunEvent runEvent;
+
+    private static final Span NO_SPAN = new Span(null, null);
+
+    private PipelineMetrics(boolean jfr, RunEvent runEvent) {
+        this.jfr = jfr;
+        this.runEvent = runEvent;
+    }
+
+    /**
+     * Metrics for one run, or null if nothing would read them
+     * (no --stats, no --report and no JFR recording with our events enabled).
+     */
+    public static PipelineMetrics forRun(MappingOptions options) {
+        RunEvent runEvent = new RunEvent();
+        boolean jfr = runEvent.isEnabled();
+        if (!jfr && !options.isPrintStats() && options.getReportFile() == null) {
+            return null;
+        }
+        runEvent.begin();
+        return new PipelineMetrics(jfr, runEvent);
+    }
+
+    /**
+     * Start timing a stage on this thread; close the Span (try-with-resources) to record it.
+     * metrics may be null, then nothing is measured.
+     */
+    public static Span span(PipelineMetrics metrics, Stage stage) {
+        return metrics == null ? NO_SPAN : new Span(metrics, stage);
+    }
+
+    /**
+     * Bytes allocated for a stage on some other (pool) thread.
+     */
+    void addAllocated(Stage stage, long allocatedBefore) {
+        if (allocatedBefore < 0) {
+            return; // no allocation counting on this JVM
+        }
+        allocatedBytes.addAndGet(stage.ordinal(), AllocationCounter.currentThreadAllocatedBytes() - allocatedBefore);
+    }
+
+    public long getWallNanos(Stage stage) {
+        return wallNanos.get(stage.ordinal());
+    }
+
+    public long getAllocatedBytes(Stage stage) {
+        return allocatedBytes.get(stage.ordinal());
+    }
+
+    /**
+     * End of the run: emits the JFR run event (if a recording wants it).
+     */
+    public void finish(FileVersion oldFile, FileVersion newFile) {
+        if (!jfr) {
+            return;
+        }
+        runEvent.end();
+        if (runEvent.shouldCommit()) {
+            runEvent.oldFile = oldFile.getFileName();
+            runEvent.newFile = newFile.getFileName();
+            runEvent.oldLines = oldFile.getLines().size();
+            runEvent.newLines = newFile.getLines().size();
+            runEvent.exactMatches = exactMatches.sum();
+            runEvent.hashCollisions = hashCollisions.sum();
+            runEvent.candidatesGenerated = candidatesGenerated.sum();
+            runEvent.pairsScored = pairsScored.sum();
+            runEvent.pairsPruned = pairsPruned.sum();
+            runEvent.acceptedBelowMinor = acceptedBelowMinor.sum();
+            runEvent.acceptedMinor = acceptedMinor.sum();
+            runEvent.splitGroups = splitGroups.sum();
+            runEvent.commit();
+        }
+    }
+
+    /**
+     * The report written by --report: stages that ran, then the counters.
+     */
+    public String toJson(FileVersion oldFile, FileVersion newFile) {
+        StringBuilder sb = new StringBuilder("{\n");
+        sb.append("  \"oldFile\": ").append(Json.quote(oldFile.getFileName())).append(",\n");
+        sb.append("  \"newFile\": ").append(Json.quote(newFile.getFileName())).append(",\n");
+        sb.append("  \"oldLines\": ").append(oldFile.getLines().size()).append(",\n");
+        sb.append("  \"newLines\": ").append(newFile.getLines().size()).append(",\n");
+        sb.append(String.format(Locale.ROOT, "  \"totalWallMs\": %.3f,\n", (System.nanoTime() - startNanos) / 1e6));
+        sb.append("  \"stages\": [");
+        String separator = "\n";
+        for (Stage stage : Stage.values()) {
+            if (spans.get(stage.ordinal()) == 0) {
+                continue; // did not run (e.g. HUNKS without --hunks)
+            }
+            sb.append(separator).append(String.format(Locale.ROOT,
+                    "    {\"stage\": %s, \"wallMs\": %.3f, \"allocatedBytes\": %d}",
+                    Json.quote(stage.label), getWallNanos(stage) / 1e6, getAllocatedBytes(stage)));
+            separator = ",\n";
+        }
+        sb.append("\n  ],\n");
+        sb.append("  \"counters\": {\n");
+        sb.append("    \"exactMatches\": ").append(exactMatches.sum()).append(",\n");
+        sb.append("    \"hashCollisions\": ").append(hashCollisions.sum()).append(",\n");
+        sb.append("    \"candidatesGenerated\": ").append(candidatesGenerated.sum()).append(",\n");
+        sb.append("    \"pairsScored\": ").append(pairsScored.sum()).append(",\n");
+        sb.append("    \"pairsPruned\": ").append(pairsPruned.sum()).append(",\n");
+        sb.append(String.format(Locale.ROOT, "    \"pruneRate\": %.4f,\n", getPruneRate()));
+        sb.append("    \"acceptedBelow0.9\": ").append(acceptedBelowMinor.sum()).append(",\n");
+        sb.append("    \"accepted0.9AndAbove\": ").append(acceptedMinor.sum()).append(",\n");
+        sb.append("    \"splitGroups\": ").append(splitGroups.sum()).append("\n");
+        sb.append("  }\n}\n");
+        return sb.toString();
+    }
+
+    /**
+     * Share of the Step 4 candidate pairs skipped by the upper bound (0 when none were seen).
+     */
+    public double getPruneRate() {
+        long pruned = pairsPruned.sum();
+        long total = pruned + pairsScored.sum();
+        return total == 0 ? 0.0 : (double) pruned / total;
+    }
+
+    /**
+     * Human-readable version for --stats.
+     */
+    public void print(PrintStream out) {
+        for (Stage stage : Stage.values()) {
+            if (spans.get(stage.ordinal()) > 0) {
+                out.printf(Locale.ROOT, "%-18s %10.3f ms %,14d bytes%n",
+                        stage.label, getWallNanos(stage) / 1e6, getAllocatedBytes(stage));
+            }
+        }
+        out.println("exact matches: " + exactMatches.sum() + ", hash collisions: " + hashCollisions.sum());
+        out.println("candidates generated: " + candidatesGenerated.sum()
+                + ", pairs scored: " + pairsScored.sum() + ", pairs pruned: " + pairsPruned.sum()
+                + String.format(Locale.ROOT, " (%.1f%%)", 100 * getPruneRate()));
+        out.println("accepted < 0.9: " + acceptedBelowMinor.sum()
+                + ", accepted >= 0.9: " + acceptedMinor.sum() + ", split groups: " + splitGroups.sum());
+    }
+
+    /**
+     * One timed stage on one thread. Not thread safe, open and close it on the same thread.
+     */
+    public static final class Span implements AutoCloseable {
+        private final PipelineMetrics metrics; // null = the shared no-op span
+        private final Stage stage;
+        private final long startNanos;
+        private final long startAllocated;
+        private final StageEvent event;
+
+        private Span(PipelineMetrics metrics, Stage stage) {
+            this.metrics = metrics;
+            this.stage = stage;
+            if (metrics == null) {
+                startNanos = 0;
+                startAllocated = 0;
+                event = null;
+                return;
+            }
+            if (metrics.jfr) {
+                event = new StageEvent();
+                event.begin();
+            } else {
+                event = null;
+            }
+            startAllocated = AllocationCounter.currentThreadAllocatedBytes();
+            startNanos = System.nanoTime();
+        }
+
+        @Override
+        public void close() {
+            if (metrics == null) {
+                return;
+            }
+            long nanos = System.nanoTime() - startNanos;
+            long allocated = startAllocated < 0 ? 0 : AllocationCounter.currentThreadAllocatedBytes() - startAllocated;
+            int i = stage.ordinal();
+            metrics.wallNanos.addAndGet(i, nanos);
+            metrics.allocatedBytes.addAndGet(i, allocated);
+            metrics.spans.incrementAndGet(i);
+            if (event != null) {
+                event.end();
+                if (event.shouldCommit()) {
+                    event.stage = stage.label;
+                    event.allocated = allocated;
+                    event.commit();
+                }
+            }
+        }
+    }
+
+    // ----- JFR events -----
+
+    @Name("tool.PipelineStage")
+    @Label("Pipeline Stage")
+    @Category("Line Mapping")
+    static final class StageEvent extends Event {
+        @Label("Stage")
+        String stage;
+
+        @Label("Allocated")
+        @DataAmount
+        long allocated;
+    }
+
+    @Name("tool.MappingRun")
+    @Label("Mapping Run")
+    @Category("Line Mapping")
+    static final class RunEvent extends Event {
+        @Label("Old File")
+        String oldFile;
+
+        @Label("New File")
+        String newFile;
+
+        @Label("Old Lines")
+        int oldLines;
+
+        @Label("New Lines")
+        int newLines;
+
+        @Label("Exact Matches")
+        long exactMatches;
+
+        @Label("Hash Collisions")
+        long hashCollisions;
+
+        @Label("Candidates Generated")
+        long candidatesGenerated;
+
+        @Label("Pairs Scored")
+        long pairsScored;
+
+        @Label("Pairs Pruned")
+        long pairsPruned;
+
+        @Label("Accepted Below 0.9")
+        long acceptedBelowMinor;
+
+        @Label("Accepted 0.9 And Above")
+        long acceptedMinor;
+
+        @Label("Split Groups")
+        long splitGroups;
+    }
+}
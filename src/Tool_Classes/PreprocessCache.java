@@ -0,0 +1,238 @@
+package tool;
+
+
+import java.io.BufferedOutputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardCopyOption;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Locale;
+
+/**
+ * Optional on-disk cache of Step 1 results, so a file we have seen before is not
+ * normalized and tokenized again (--cache-dir).
+ *
+ * Key: SHA-256 of the raw file bytes + Normalizer profile + context window, so the same
+ * blob under another name (or another commit) hits the same entry.
+ * One entry is one binary file, memory-mapped when read back:
+ *
+ *   magic, format version, source byte length, line count, token count, token occurrences, id count
+ *   token table        the file's own tokens as UTF-8 strings; entry ids are indexes into it
+ *   line starts/ends   byte offsets into the source file (no newline scan on a hit)
+ *   content simhash    per line
+ *   context simhash    per line
+ *   line hash + check  per line, the normalized line key for TokenDictionary.internLine
+ *   row offsets + ids  token ids of every line, in entry ids
+ *   start states       Normalizer state at the start of each line
+ *
+ * Token ids differ between dictionaries, so a hit interns the token table into the
+ * Preprocessor's dictionary and remaps the rows. SimHash fingerprints and line hashes only
+ * depend on the text, so they are stored as they are and a hit re-interns the line ids:
+ * Step 2 then matches by id and nothing is normalized again. A bad or truncated entry is a miss.
+ */
+public class PreprocessCache {
+
+    private static final int MAGIC = 0x4C4D4656; // "LMFV"
+    private static final int FORMAT_VERSION = 3; // 2: line hashes, 3: comment-only lines keep their text
+
+    private final Path directory;
+
+    /**
+     * What a hit gives back: the file plus its pre-dedup token count (for --stats).
+     */
+    static final class Hit {
+        final FileVersion file;
+        final long tokenOccurrences;
+
+        Hit(FileVersion file, long tokenOccurrences) {
+            this.file = file;
+            this.tokenOccurrences = tokenOccurrences;
+        }
+    }
+
+    public PreprocessCache(Path directory) throws IOException {
+        this.directory = directory;
+        Files.createDirectories(directory);
+    }
+
+    /**
+     * Cache entry name for these bytes loaded with this profile and window.
+     */
+    static String key(ByteBuffer sourceBytes, Normalizer.Profile profile, int contextWindow) {
+        MessageDigest sha;
+        try {
+            sha = MessageDigest.getInstance("SHA-256");
+        } catch (NoSuchAlgorithmException ex) {
+            throw new IllegalStateException(ex); // every JRE has SHA-256
+        }
+        sha.update(sourceBytes.duplicate());
+        StringBuilder sb = new StringBuilder(80);
+        for (byte b : sha.digest()) {
+            sb.append(Character.forDigit((b >> 4) & 0xF, 16)).append(Character.forDigit(b & 0xF, 16));
+        }
+        return sb.append('-').append(profile.name().toLowerCase(Locale.ROOT)).append("-w").append(contextWindow)
+                .append(".fv").toString();
+    }
+
+    /**
+     * Rebuild the FileVersion from the cache, or null on a miss.
+     */
+    Hit load(String key, String path, ByteBuffer sourceBytes, Normalizer.Profile profile,
+             TokenDictionary dictionary) {
+        Path entry = directory.resolve(key);
+        if (!Files.isRegularFile(entry)) {
+            return null;
+        }
+        try {
+            ByteBuffer in = MappedLines.mapFile(entry);
+            if (in.getInt() != MAGIC || in.getInt() != FORMAT_VERSION || in.getInt() != sourceBytes.limit()) {
+                return null;
+            }
+            int n = in.getInt();
+            int tokenCount = in.getInt();
+            long tokenOccurrences = in.getLong();
+            int idCount = in.getInt();
+
+            // entry id -> id in this dictionary
+            int[] remap = new int[tokenCount];
+            for (int t = 0; t < tokenCount; t++) {
+                byte[] utf8 = new byte[in.getInt()];
+                in.get(utf8);
+                remap[t] = dictionary.intern(new String(utf8, StandardCharsets.UTF_8));
+            }
+
+            int[] starts = new int[n];
+            int[] ends = new int[n];
+            long[] contentHashes = new long[n];
+            long[] contextHashes = new long[n];
+            long[] lineHashes = new long[n];
+            int[] lineChecks = new int[n];
+            int[] rowOffsets = new int[n + 1];
+            int[] ids = new int[idCount];
+            byte[] startStates = new byte[n];
+            readInts(in, starts);
+            readInts(in, ends);
+            readLongs(in, contentHashes);
+            readLongs(in, contextHashes);
+            readLongs(in, lineHashes);
+            readInts(in, lineChecks);
+            readInts(in, rowOffsets);
+            readInts(in, ids);
+            in.get(startStates);
+
+            MappedLines text = MappedLines.withOffsets(sourceBytes, starts, ends);
+            text.setNormalization(profile, startStates);
+
+            List<LineRecord> records = new ArrayList<>(n);
+            for (int i = 0; i < n; i++) {
+                int[] row = new int[rowOffsets[i + 1] - rowOffsets[i]];
+                for (int k = 0; k < row.length; k++) {
+                    row[k] = remap[ids[rowOffsets[i] + k]];
+                }
+                Arrays.sort(row); // remapped ids are distinct but no longer in order
+                int lineId = dictionary.internLine(lineHashes[i], lineChecks[i]);
+                records.add(new LineRecord(i + 1, text, row, lineId, contentHashes[i], contextHashes[i]));
+            }
+            return new Hit(new FileVersion(path, records, dictionary), tokenOccurrences);
+        } catch (IOException | RuntimeException ex) { // truncated or damaged entry
+            return null;
+        }
+    }
+
+    /**
+     * Write the entry for a freshly preprocessed file. Failing to write only costs the
+     * next run some time, so errors are reported and ignored.
+     */
+    void store(String key, MappedLines text, int[][] tokens, long[] contentHashes, long[] contextHashes,
+               long[] lineHashes, int[] lineChecks, TokenDictionary dictionary, long tokenOccurrences) {
+        int n = text.size();
+
+        // local ids in ascending dictionary id order, so the stored rows stay sorted
+        int maxId = -1;
+        for (int[] row : tokens) {
+            if (row.length > 0) maxId = Math.max(maxId, row[row.length - 1]);
+        }
+        int[] local = new int[maxId + 1];
+        Arrays.fill(local, -1);
+        int idCount = 0;
+        for (int[] row : tokens) {
+            idCount += row.length;
+            for (int id : row) local[id] = 0;
+        }
+        List<String> tokenTable = new ArrayList<>();
+        for (int id = 0; id <= maxId; id++) {
+            if (local[id] == 0) {
+                local[id] = tokenTable.size();
+                tokenTable.add(dictionary.getToken(id));
+            }
+        }
+
+        Path temp = null;
+        try {
+            temp = Files.createTempFile(directory, "entry", ".tmp");
+            try (DataOutputStream out = new DataOutputStream(new BufferedOutputStream(Files.newOutputStream(temp)))) {
+                out.writeInt(MAGIC);
+                out.writeInt(FORMAT_VERSION);
+                out.writeInt(text.getBytes().limit());
+                out.writeInt(n);
+                out.writeInt(tokenTable.size());
+                out.writeLong(tokenOccurrences);
+                out.writeInt(idCount);
+                for (String token : tokenTable) {
+                    byte[] utf8 = token.getBytes(StandardCharsets.UTF_8);
+                    out.writeInt(utf8.length);
+                    out.write(utf8);
+                }
+                for (int i = 0; i < n; i++) out.writeInt(text.lineStart(i));
+                for (int i = 0; i < n; i++) out.writeInt(text.lineEnd(i));
+                for (int i = 0; i < n; i++) out.writeLong(contentHashes[i]);
+                for (int i = 0; i < n; i++) out.writeLong(contextHashes[i]);
+                for (int i = 0; i < n; i++) out.writeLong(lineHashes[i]);
+                for (int i = 0; i < n; i++) out.writeInt(lineChecks[i]);
+                int offset = 0;
+                out.writeInt(0);
+                for (int[] row : tokens) {
+                    offset += row.length;
+                    out.writeInt(offset);
+                }
+                for (int[] row : tokens) {
+                    for (int id : row) out.writeInt(local[id]);
+                }
+                for (int i = 0; i < n; i++) out.writeByte(text.getStartState(i));
+            }
+            // readers only ever see a complete entry
+            Files.move(temp, directory.resolve(key), StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE);
+            temp = null;
+        } catch (IOException ex) {
+            System.err.println("Could not write cache entry " + key + ": " + ex);
+        } finally {
+            if (temp != null) {
+                try {
+                    Files.deleteIfExists(temp);
+                } catch (IOException ignored) {
+                    // nothing more we can do
+                }
+            }
+        }
+    }
+
+    // ----- helpers -----
+
+    private static void readInts(ByteBuffer in, int[] into) {
+        in.asIntBuffer().get(into);
+        in.position(in.position() + 4 * into.length);
+    }
+
+    private static void readLongs(ByteBuffer in, long[] into) {
+        in.asLongBuffer().get(into);
+        in.position(in.position() + 8 * into.length);
+    }
+}
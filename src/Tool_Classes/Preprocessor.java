@@ -2,50 +2,164 @@ package tool;
 
 
 import java.io.IOException;
-import java.nio.file.Files;
+import java.nio.ByteBuffer;
 import java.nio.file.Path;
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.List;
 
 /**
  * Step 1: READ AND NORMALIZE LINES
  * Loads a file from disk, reads it line by line, and builds a FileVersion
- * Each line is converted into a LineRecord with both original and normalized text
+ * Each line is converted into a LineRecord with the sorted ids of its tokens
+ * (tokenized once here, reused by every later step)
+ * We also compute SimHash fingerprints of each line and of its context window
+ *
+ * The file is memory-mapped (MappedLines) and each line is normalized (Normalizer,
+ * which also drops comments for the file's language) into a reused buffer and tokenized
+ * from there, so no String per line is built here; the original and normalized text
+ * are only made when a later step asks the LineRecord for them. Step 2 does not need
+ * them: every line gets a line id from the hash of its normalized buffer.
+ *
+ * With a PreprocessCache, a file whose bytes were seen before is rebuilt from the cache
+ * entry instead (no normalizing or tokenizing at all).
  */
 
 public class Preprocessor {
 
+    // shared by every file this Preprocessor loads, so old/new token ids line up
+    private final TokenDictionary dictionary = new TokenDictionary();
+
+    private final int contextWindow; // lines above/below used for the context fingerprint
+    private final boolean stripComments; // pick the Normalizer profile from the file extension
+    private final PreprocessCache cache; // null = no cache
+
+    private long tokenOccurrences; // tokens seen before de-duplication, for --stats
+
+    public Preprocessor() {
+        this(2); // same default window as SimilarityCalculator
+    }
+
+    public Preprocessor(int contextWindow) {
+        this(contextWindow, false); // comments kept, like MappingOptions' default
+    }
+
+    public Preprocessor(int contextWindow, boolean stripComments) {
+        this(contextWindow, stripComments, null);
+    }
+
+    public Preprocessor(int contextWindow, boolean stripComments, PreprocessCache cache) {
+        this.contextWindow = contextWindow;
+        this.stripComments = stripComments;
+        this.cache = cache;
+    }
+
     /**
      * Read the file from the given path and return a FileVersion object.
      */
     public FileVersion loadFile(String path) throws IOException {
-        List<String> rawLines = Files.readAllLines(Path.of(path));
-        List<LineRecord> records = new ArrayList<>();
-
-        int lineNo = 1;
-        for (String line : rawLines) {
-            String normalized = normalize(line);
-            records.add(new LineRecord(lineNo, line, normalized));
-            lineNo++;
+        ByteBuffer bytes = MappedLines.mapFile(Path.of(path));
+        int malformed = MappedLines.malformedOffset(bytes);
+        if (malformed >= 0) { // Files.readAllLines used to fail here; we map it, but say so
+            System.err.println("warning: " + path + " is not valid UTF-8 (line "
+                    + MappedLines.lineOf(bytes, malformed) + "), bad bytes are read as U+FFFD");
+        }
+        Normalizer.Profile profile = stripComments ? Normalizer.profileFor(path) : Normalizer.Profile.PLAIN;
+
+        String cacheKey = null;
+        if (cache != null) {
+            cacheKey = PreprocessCache.key(bytes, profile, contextWindow);
+            PreprocessCache.Hit hit = cache.load(cacheKey, path, bytes, profile, dictionary);
+            if (hit != null) {
+                tokenOccurrences += hit.tokenOccurrences;
+                return hit.file;
+            }
+        }
+
+        MappedLines text = MappedLines.split(bytes);
+        int n = text.size();
+        long occurrencesBefore = tokenOccurrences;
+
+        // one pass in file order: block comments carry over from line to line
+        Normalizer normalizer = new Normalizer(profile);
+        byte[] startStates = new byte[n];
+        int[][] tokens = new int[n][];
+        long[] lineHashes = new long[n];
+        int[] lineChecks = new int[n];
+        for (int i = 0; i < n; i++) {
+            startStates[i] = normalizer.getState();
+            int length = normalizer.normalize(text, i);
+            char[] buffer = normalizer.getBuffer();
+            tokens[i] = tokenize(buffer, length);
+            lineHashes[i] = TokenDictionary.lineHash(buffer, length);
+            lineChecks[i] = TokenDictionary.lineCheck(buffer, length);
         }
+        text.setNormalization(normalizer.getProfile(), startStates);
 
-        return new FileVersion(path, records);
+        // fingerprints for SimHash scoring
+        long[] tokenHashes = dictionary.getTokenHashes();
+        long[] contextHashes = SimHash.windowFingerprints(tokens, tokenHashes, contextWindow);
+
+        long[] contentHashes = new long[n];
+        List<LineRecord> records = new ArrayList<>(n);
+        for (int i = 0; i < n; i++) {
+            contentHashes[i] = SimHash.fingerprint(tokens[i], tokenHashes);
+            int lineId = dictionary.internLine(lineHashes[i], lineChecks[i]);
+            records.add(new LineRecord(i + 1, text, tokens[i], lineId, contentHashes[i], contextHashes[i]));
+        }
+
+        if (cache != null) {
+            cache.store(cacheKey, text, tokens, contentHashes, contextHashes, lineHashes, lineChecks, dictionary,
+                    tokenOccurrences - occurrencesBefore);
+        }
+
+        return new FileVersion(path, records, dictionary);
+    }
+
+    public TokenDictionary getDictionary() {
+        return dictionary;
+    }
+
+    public long getTokenOccurrences() {
+        return tokenOccurrences;
     }
 
     /**
-     * Very simple normalization to ignore small formatting changes:
-        * Trim leading/trailing spaces
-        * Collapse multiple spaces/tabs into a single space
-        * Convert everything to lowercase
-     * Same step shown in the professor's PPT
+     * Split on non-word characters (same tokens as text.split("\\W+")),
+     * intern each token and return the distinct ids in ascending order.
      */
-    private String normalize(String line) {
-        if (line == null) {
-            return "";
+    private int[] tokenize(char[] text, int length) {
+        int[] ids = new int[8];
+        int count = 0;
+
+        int i = 0;
+        while (i < length) {
+            while (i < length && !isWordChar(text[i])) i++; // skip separators
+            int start = i;
+            while (i < length && isWordChar(text[i])) i++;  // read one token
+            if (i > start) {
+                if (count == ids.length) ids = Arrays.copyOf(ids, count * 2);
+                ids[count++] = dictionary.intern(text, start, i); // no String unless the token is new
+            }
         }
-        return line
-                .trim()
-                .replaceAll("\\s+", " ")
-                .toLowerCase();
+        return sortedDistinct(ids, count);
+    }
+
+    // sort + drop duplicates so later steps can merge the arrays like sets
+    private int[] sortedDistinct(int[] ids, int count) {
+        tokenOccurrences += count;
+        Arrays.sort(ids, 0, count);
+        int distinct = 0;
+        for (int k = 0; k < count; k++) {
+            if (distinct == 0 || ids[distinct - 1] != ids[k]) {
+                ids[distinct++] = ids[k];
+            }
+        }
+        return Arrays.copyOf(ids, distinct);
+    }
+
+    // \w in Java regex (without UNICODE_CHARACTER_CLASS) is [a-zA-Z_0-9]
+    private static boolean isWordChar(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
     }
 }
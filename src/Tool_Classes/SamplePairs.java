@@ -0,0 +1,161 @@
+package tool;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
+
+/**
+ * Finds the old/new source pairs under file_mapping/.
+ *
+ * Every member named their files differently, so we go by a few rules per folder:
+ *  - a folder with "...old" and "...new" subfolders holding one source file each is one pair
+ *    (line-mapping-tahrima/file-N/file-old, file-new)
+ *  - otherwise source files whose names contain "old" / "new" are paired when the rest of
+ *    the name matches ("old calculator.c" + "New.calculator.c", "old1.java" + "new1.java")
+ *  - a leftover "new" file pairs with the single other leftover file of the same type
+ *    ("RunBomberman.java" + "RunBomberman new.java")
+ * Ground truth files (.xml, .csv, .txt, .md) are never part of a pair.
+ */
+public final class SamplePairs {
+
+    /**
+     * One old/new pair found on disk.
+     */
+    public static final class Pair {
+        public final Path oldPath;
+        public final Path newPath;
+
+        Pair(Path oldPath, Path newPath) {
+            this.oldPath = oldPath;
+            this.newPath = newPath;
+        }
+
+        @Override
+        public String toString() {
+            return oldPath + " -> " + newPath;
+        }
+    }
+
+    private SamplePairs() {
+    }
+
+    /**
+     * All pairs under root, in a stable (path) order.
+     */
+    public static List<Pair> find(Path root) throws IOException {
+        List<Path> folders;
+        try (Stream<Path> walk = Files.walk(root)) {
+            folders = walk.filter(Files::isDirectory).sorted().collect(Collectors.toList());
+        }
+        List<Pair> pairs = new ArrayList<>();
+        for (Path folder : folders) {
+            pairs.addAll(findInFolder(folder));
+        }
+        return pairs;
+    }
+
+    /**
+     * The part of a file name that old and new share: no extension, no "old"/"new",
+     * lowercase letters and digits only ("old Lab8 - Copy.c" -> "lab8copy").
+     */
+    static String stem(Path file) {
+        String name = file.getFileName().toString().toLowerCase(Locale.ROOT);
+        int dot = name.lastIndexOf('.');
+        if (dot > 0) name = name.substring(0, dot);
+        name = name.replace("old", "").replace("new", "");
+        StringBuilder sb = new StringBuilder();
+        for (int i = 0; i < name.length(); i++) {
+            char c = name.charAt(i);
+            if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) sb.append(c);
+        }
+        return sb.toString();
+    }
+
+    static boolean isSource(Path file) {
+        String ext = extension(file);
+        return !ext.isEmpty() && !ext.equals("xml") && !ext.equals("csv") && !ext.equals("txt") && !ext.equals("md");
+    }
+
+    // ----- helpers -----
+
+    private static List<Pair> findInFolder(Path folder) throws IOException {
+        List<Pair> pairs = new ArrayList<>();
+        List<Path> files = new ArrayList<>();
+        Path oldDir = null;
+        Path newDir = null;
+        try (Stream<Path> list = Files.list(folder)) {
+            for (Path p : list.sorted().collect(Collectors.toList())) {
+                String name = p.getFileName().toString().toLowerCase(Locale.ROOT);
+                if (Files.isDirectory(p)) {
+                    if (name.endsWith("old")) oldDir = p;
+                    else if (name.endsWith("new")) newDir = p;
+                } else if (isSource(p)) {
+                    files.add(p);
+                }
+            }
+        }
+
+        if (oldDir != null && newDir != null) {
+            List<Path> oldFiles = sourceFiles(oldDir);
+            List<Path> newFiles = sourceFiles(newDir);
+            if (oldFiles.size() == 1 && newFiles.size() == 1) {
+                pairs.add(new Pair(oldFiles.get(0), newFiles.get(0)));
+            }
+        }
+
+        // by extension, then by shared stem
+        Map<String, List<Path>> olds = new LinkedHashMap<>();
+        Map<String, List<Path>> news = new LinkedHashMap<>();
+        for (Path file : files) {
+            String name = file.getFileName().toString().toLowerCase(Locale.ROOT);
+            String ext = extension(file);
+            if (name.contains("new")) {
+                news.computeIfAbsent(ext, e -> new ArrayList<>()).add(file);
+            } else {
+                olds.computeIfAbsent(ext, e -> new ArrayList<>()).add(file); // "old..." or unmarked
+            }
+        }
+
+        for (Map.Entry<String, List<Path>> e : news.entrySet()) {
+            List<Path> newFiles = new ArrayList<>(e.getValue());
+            List<Path> oldFiles = new ArrayList<>(olds.getOrDefault(e.getKey(), new ArrayList<>()));
+
+            Map<String, Path> oldByStem = new HashMap<>();
+            for (Path oldFile : oldFiles) oldByStem.putIfAbsent(stem(oldFile), oldFile);
+            for (Path newFile : new ArrayList<>(newFiles)) {
+                Path oldFile = oldByStem.remove(stem(newFile));
+                if (oldFile != null) {
+                    pairs.add(new Pair(oldFile, newFile));
+                    oldFiles.remove(oldFile);
+                    newFiles.remove(newFile);
+                }
+            }
+            if (newFiles.size() == 1 && oldFiles.size() == 1) {
+                pairs.add(new Pair(oldFiles.get(0), newFiles.get(0)));
+            }
+        }
+        pairs.sort(Comparator.comparing(p -> p.oldPath.toString()));
+        return pairs;
+    }
+
+    private static List<Path> sourceFiles(Path folder) throws IOException {
+        try (Stream<Path> list = Files.list(folder)) {
+            return list.filter(Files::isRegularFile).filter(SamplePairs::isSource).sorted().collect(Collectors.toList());
+        }
+    }
+
+    private static String extension(Path file) {
+        String name = file.getFileName().toString();
+        int dot = name.lastIndexOf('.');
+        return dot < 0 ? "" : name.substring(dot + 1).toLowerCase(Locale.ROOT);
+    }
+}
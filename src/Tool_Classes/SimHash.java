@@ -0,0 +1,99 @@
+package tool;
+
+
+/**
+ * 64-bit SimHash fingerprints, as in the original LHDiff design.
+ *
+ * Every token has a 64-bit hash (TokenDictionary.getTokenHash). For a bag of tokens
+ * we add +1 to counter b when bit b of a token hash is set and -1 when it is not;
+ * the fingerprint has bit b set when counter b ends up positive.
+ * Similar bags give fingerprints that differ in few bits (small Hamming distance).
+ */
+public final class SimHash {
+
+    private SimHash() {
+    }
+
+    /**
+     * Fingerprint of one line's tokens.
+     */
+    public static long fingerprint(int[] tokenIds, long[] tokenHashes) {
+        int[] counters = new int[64];
+        add(counters, tokenIds, tokenHashes, 1);
+        return fromCounters(counters);
+    }
+
+    /**
+     * Context fingerprints for every line: the tokens of lines [i - window, i + window]
+     * (clipped to the file) as one bag. Rolling window, so each line is added once
+     * and removed once.
+     *
+     * @param rows token ids per line, 0-based
+     */
+    public static long[] windowFingerprints(int[][] rows, long[] tokenHashes, int window) {
+        int n = rows.length;
+        long[] result = new long[n];
+        int[] counters = new int[64];
+
+        for (int r = 0; r <= window && r < n; r++) {
+            add(counters, rows[r], tokenHashes, 1); // initial window for line 0
+        }
+        for (int i = 0; i < n; i++) {
+            result[i] = fromCounters(counters);
+            int leaving = i - window;
+            int entering = i + window + 1;
+            if (leaving >= 0) add(counters, rows[leaving], tokenHashes, -1);
+            if (entering < n) add(counters, rows[entering], tokenHashes, 1);
+        }
+        return result;
+    }
+
+    /**
+     * Similarity in [0, 1] from the Hamming distance of two fingerprints.
+     * Unrelated fingerprints differ in about 32 of 64 bits, so we scale so that
+     * 32 or more differing bits is 0 and identical fingerprints are 1.
+     */
+    public static double similarity(long a, long b) {
+        int distance = Long.bitCount(a ^ b);
+        return distance >= 32 ? 0.0 : 1.0 - distance / 32.0;
+    }
+
+    /**
+     * similarity(query, fingerprints[lines[k] - 1]) for k < count, into out[k].
+     * One old line against a block of candidates: XOR + popcount over a primitive
+     * array, nothing per pair to look up. Runs on BlockKernels.ACTIVE, so with the
+     * Vector API module this is several candidates per instruction.
+     *
+     * @param lines 1-based line numbers into fingerprints
+     */
+    public static void similarityBlock(long query, long[] fingerprints, int[] lines, int count, double[] out) {
+        BlockKernels.ACTIVE.similarityBlock(query, fingerprints, lines, count, out);
+    }
+
+    // the scalar similarityBlock (BlockKernels.SCALAR)
+    static void similarityBlockScalar(long query, long[] fingerprints, int[] lines, int count, double[] out) {
+        for (int k = 0; k < count; k++) {
+            int distance = Long.bitCount(query ^ fingerprints[lines[k] - 1]);
+            out[k] = distance >= 32 ? 0.0 : 1.0 - distance / 32.0;
+        }
+    }
+
+    // ----- helpers -----
+
+    private static void add(int[] counters, int[] tokenIds, long[] tokenHashes, int sign) {
+        for (int id : tokenIds) {
+            long h = tokenHashes[id];
+            for (int bit = 0; bit < 64; bit++) {
+                counters[bit] += ((h >>> bit) & 1L) != 0 ? sign : -sign;
+            }
+        }
+    }
+
+    private static long fromCounters(int[] counters) {
+        long fingerprint = 0;
+        for (int bit = 0; bit < 64; bit++) {
+            if (counters[bit] > 0) fingerprint |= 1L << bit;
+        }
+        return fingerprint;
+    }
+}
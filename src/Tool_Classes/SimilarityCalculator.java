@@ -2,9 +2,6 @@ package tool;
 
 
 
-import java.util.*;
-import java.util.stream.Collectors;
-
 /**
  * Step 4: COMPUTE SIMILARITY
  *
@@ -12,28 +9,119 @@ import java.util.stream.Collectors;
  *   - content similarity between two lines (based on token Jaccard)
  *   - context similarity between neighborhoods around two lines
  *   - combined similarity = 0.6 * content + 0.4 * context
+ *
+ * Jaccard runs on the precomputed token ids (see JaccardKernel), so scoring a
+ * pair does not build any sets.
+ *
+ * In SIMHASH mode content and context are instead scored from the Preprocessor's
+ * SimHash fingerprints (a XOR and a popcount each). Scores that land within
+ * fallbackBand of the mapping threshold are recomputed with exact Jaccard, so
+ * the accept/reject decision near the threshold stays exact.
+ *
+ * In LEVENSHTEIN mode content is 1 - edit distance / longer length of the normalized
+ * lines, like the original LHDiff, so a slightly renamed identifier still scores high
+ * (token Jaccard gives it 0). EditDistanceKernel computes it bit-parallel and stops
+ * once the distance is more than the threshold allows. Context stays token Jaccard.
+ *
+ * upperBound gives the best combined score a pair could reach from the token
+ * counts alone, so the Mapper can skip pairs that cannot make the threshold.
  */
 public class SimilarityCalculator { // this is for similarity calculation
 
+    // up to this many distinct tokens a context set fits in a few longs,
+    // and AND/OR + popcount beats merging the sorted arrays
+    static final int BITSET_MAX_TOKENS = 512;
+
+    // per thread context scores of the SIMHASH block, grown as needed (scoring runs on a pool)
+    private static final ThreadLocal<double[][]> CONTEXT_SCRATCH = ThreadLocal.withInitial(() -> new double[1][64]);
+
+    /**
+     * JACCARD - exact token Jaccard for content and context
+     * SIMHASH - Hamming distance of SimHash fingerprints
+     * LEVENSHTEIN - normalized edit distance of the lines for content, Jaccard for context
+     */
+    public enum Mode { JACCARD, SIMHASH, LEVENSHTEIN }
+
     private final int contextWindow; // number of lines above/below to use as context
+    private final Mode mode;
+    private final double threshold;    // mapping threshold, for the SIMHASH fallback and the LEVENSHTEIN early exit
+    private final double fallbackBand; // SIMHASH scores in [threshold - band, threshold + band] are redone exactly
 
     public SimilarityCalculator(int contextWindow) { // we set the context window here
+        this(contextWindow, Mode.JACCARD, 0.0, 0.0);
+    }
+
+    /**
+     * @param contextWindow lines above/below used as context (must match the Preprocessor's
+     *                      window in SIMHASH mode, the context fingerprints were built with it)
+     * @param mode          how to score pairs
+     * @param threshold     the Mapper's similarity threshold (0 = LEVENSHTEIN never stops early)
+     * @param fallbackBand  SIMHASH only: recompute with Jaccard when this close to threshold (0 = never)
+     */
+    public SimilarityCalculator(int contextWindow, Mode mode, double threshold, double fallbackBand) {
         this.contextWindow = contextWindow;
+        this.mode = mode;
+        this.threshold = threshold;
+        this.fallbackBand = fallbackBand;
     }
 
     public double contentSimilarity(LineRecord oldLine, LineRecord newLine) { // to compute content similarity
-        Set<String> tokens1 = tokenize(oldLine.getNormalizedText());
-        Set<String> tokens2 = tokenize(newLine.getNormalizedText());
-        return jaccard(tokens1, tokens2);
+        return JaccardKernel.jaccard(oldLine.getTokenIds(), newLine.getTokenIds());
+    }
+
+    public Mode getMode() {
+        return mode;
+    }
+
+    /**
+     * LEVENSHTEIN content score of an old line against some text (Step 5: a group of new
+     * lines joined by spaces). Only exact at or above minSimilarity; below it the result
+     * is just guaranteed to stay below too (EditDistanceKernel's early exit).
+     */
+    public double editSimilarity(String oldText, CharSequence text, double minSimilarity) {
+        return EditDistanceKernel.similarity(oldText, text, minSimilarity);
+    }
+
+    /**
+     * Upper bound of combinedSimilarity from the two token set sizes only:
+     * Jaccard(a, b) <= min(|a|, |b|) / max(|a|, |b|) and context similarity <= 1.
+     * SimHash estimates do not obey that bound, so in SIMHASH mode this is always 1.0.
+     * In LEVENSHTEIN mode the distance is at least the length difference, so the same
+     * min/max holds for the normalized text lengths.
+     */
+    public double upperBound(LineRecord oldLine, LineRecord newLine) {
+        if (mode == Mode.SIMHASH) {
+            return 1.0;
+        }
+        if (mode == Mode.LEVENSHTEIN) {
+            int a = oldLine.getNormalizedText().length();
+            int b = newLine.getNormalizedText().length();
+            int max = Math.max(a, b);
+            // written like EditDistanceKernel.similarity, so it is never below the real score
+            double content = max == 0 ? 1.0 : 1.0 - (double) (max - Math.min(a, b)) / max;
+            return 0.6 * content + 0.4;
+        }
+        int a = oldLine.getTokenIds().length;
+        int b = newLine.getTokenIds().length;
+        int max = Math.max(a, b);
+        double content = max == 0 ? 1.0 : (double) Math.min(a, b) / max; // same division as the real Jaccard, so never below it
+        return 0.6 * content + 0.4;
     }
 
     public double contextSimilarity(FileVersion oldFile, int oldLineNum, // to compute context similarity
                                     FileVersion newFile, int newLineNum) {
 
-        Set<String> contextOld = collectContextTokens(oldFile, oldLineNum);
-        Set<String> contextNew = collectContextTokens(newFile, newLineNum);
+        // context sets were built once per file with a sliding window, we only look them up
+        ContextTokens contextOld = oldFile.getContextTokens(contextWindow);
+        ContextTokens contextNew = newFile.getContextTokens(contextWindow);
 
-        return jaccard(contextOld, contextNew);
+        if (contextOld.getTokenIdLimit() <= BITSET_MAX_TOKENS
+                && contextNew.getTokenIdLimit() <= BITSET_MAX_TOKENS) {
+            return JaccardKernel.jaccard(
+                    contextOld.getBits()[oldLineNum - 1],
+                    contextNew.getBits()[newLineNum - 1]);
+        }
+        return JaccardKernel.jaccard(contextOld.get(oldLineNum), contextNew.get(newLineNum));
     }
 
     public double combinedSimilarity(FileVersion oldFile, int oldLineNum, // we combine both similarities here
@@ -42,53 +130,92 @@ public class SimilarityCalculator { // this is for similarity calculation
         LineRecord oldLine = getLine(oldFile, oldLineNum);
         LineRecord newLine = getLine(newFile, newLineNum);
 
-        double contentSim = contentSimilarity(oldLine, newLine);
+        if (mode == Mode.SIMHASH) {
+            double estimate = 0.6 * SimHash.similarity(oldLine.getContentSimHash(), newLine.getContentSimHash())
+                    + 0.4 * SimHash.similarity(oldLine.getContextSimHash(), newLine.getContextSimHash());
+            if (Math.abs(estimate - threshold) > fallbackBand) {
+                return estimate; // clearly above or below the threshold
+            }
+        }
+
+        return exactSimilarity(oldFile, oldLineNum, oldLine, newFile, newLineNum);
+    }
+
+    // the non-SimHash score: content by mode, context by Jaccard
+    private double exactSimilarity(FileVersion oldFile, int oldLineNum, LineRecord oldLine,
+                                   FileVersion newFile, int newLineNum) {
+        LineRecord newLine = getLine(newFile, newLineNum);
+        double contentSim;
+        if (mode == Mode.LEVENSHTEIN) {
+            // below this content the pair misses the threshold even with a perfect context
+            double minContent = (threshold - 0.4) / 0.6;
+            contentSim = EditDistanceKernel.similarity(
+                    oldLine.getNormalizedText(), newLine.getNormalizedText(), minContent);
+        } else {
+            contentSim = contentSimilarity(oldLine, newLine);
+        }
         double contextSim = contextSimilarity(oldFile, oldLineNum, newFile, newLineNum);
 
         
         return 0.6 * contentSim + 0.4 * contextSim; // weighted combination
     }
 
-    // ----- helpers -----
-
-    private LineRecord getLine(FileVersion file, int lineNumber) { // getting line by line number
-        return file.getLines().get(lineNumber - 1);
-    }
+    /**
+     * combinedSimilarity of one old line against count candidate new lines, into out[k].
+     * Same numbers as calling combinedSimilarity per pair, but the SimHash estimates and
+     * the bitset context scores are done for the whole block at once
+     * (SimHash.similarityBlock, JaccardKernel.jaccardBlock) over the FileVersion arrays.
+     *
+     * @param newLineNums 1-based candidate new lines (only the first count are used)
+     */
+    public void combinedSimilarityBlock(FileVersion oldFile, int oldLineNum,
+                                        FileVersion newFile, int[] newLineNums, int count, double[] out) {
+        LineRecord oldLine = getLine(oldFile, oldLineNum);
 
-    private Set<String> collectContextTokens(FileVersion file, int centerLine) { // collecting context tokens
-        int size = file.getLines().size();
-        int start = Math.max(1, centerLine - contextWindow);
-        int end   = Math.min(size, centerLine + contextWindow);
+        if (mode == Mode.SIMHASH) {
+            double[] context = contextScratch(count);
+            SimHash.similarityBlock(oldLine.getContentSimHash(), newFile.getContentSimHashes(), newLineNums, count, out);
+            SimHash.similarityBlock(oldLine.getContextSimHash(), newFile.getContextSimHashes(), newLineNums, count, context);
+            for (int k = 0; k < count; k++) {
+                double estimate = 0.6 * out[k] + 0.4 * context[k];
+                out[k] = Math.abs(estimate - threshold) > fallbackBand
+                        ? estimate // clearly above or below the threshold
+                        : exactSimilarity(oldFile, oldLineNum, oldLine, newFile, newLineNums[k]);
+            }
+            return;
+        }
 
-        Set<String> tokens = new HashSet<>(); // collect tokens in the context window
-        for (int lineNum = start; lineNum <= end; lineNum++) {
-            String text = getLine(file, lineNum).getNormalizedText();
-            tokens.addAll(tokenize(text));
+        ContextTokens contextOld = oldFile.getContextTokens(contextWindow);
+        ContextTokens contextNew = newFile.getContextTokens(contextWindow);
+        if (mode == Mode.JACCARD
+                && contextOld.getTokenIdLimit() <= BITSET_MAX_TOKENS
+                && contextNew.getTokenIdLimit() <= BITSET_MAX_TOKENS) {
+            JaccardKernel.jaccardBlock(contextOld.getBits()[oldLineNum - 1], contextNew.getBits(), newLineNums, count, out);
+            int[] oldTokens = oldLine.getTokenIds();
+            for (int k = 0; k < count; k++) {
+                double contentSim = JaccardKernel.jaccard(oldTokens, getLine(newFile, newLineNums[k]).getTokenIds());
+                out[k] = 0.6 * contentSim + 0.4 * out[k];
+            }
+            return;
         }
-        return tokens;
-    }
 
-    private Set<String> tokenize(String text) { // we tokenize the text here
-        if (text == null || text.isBlank()) {
-            return Collections.emptySet();
+        for (int k = 0; k < count; k++) {
+            out[k] = exactSimilarity(oldFile, oldLineNum, oldLine, newFile, newLineNums[k]);
         }
-        return Arrays.stream(text.split("\\W+"))
-                .filter(s -> !s.isBlank())
-                .collect(Collectors.toSet());
     }
 
-    private double jaccard(Set<String> a, Set<String> b) {
-        if (a.isEmpty() && b.isEmpty()) {
-            return 1.0;
-        }
-        Set<String> intersection = new HashSet<>(a);
-        intersection.retainAll(b);
+    // ----- helpers -----
 
-        Set<String> union = new HashSet<>(a);
-        union.addAll(b);
+    private LineRecord getLine(FileVersion file, int lineNumber) { // getting line by line number
+        return file.getLines().get(lineNumber - 1);
+    }
 
-        if (union.isEmpty()) return 0.0;
-        return (double) intersection.size() / union.size();
+    // this thread's scratch array, at least count long
+    private static double[] contextScratch(int count) {
+        double[][] holder = CONTEXT_SCRATCH.get();
+        if (holder[0].length < count) {
+            holder[0] = new double[Math.max(count, 2 * holder[0].length)];
+        }
+        return holder[0];
     }
 }
-
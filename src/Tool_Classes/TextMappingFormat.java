@@ -0,0 +1,53 @@
+package tool;
+
+
+import java.io.BufferedWriter;
+import java.io.IOException;
+import java.io.Writer;
+import java.nio.file.Files;
+import java.nio.file.Path;
+
+/**
+ * LHDiff-style plain text mapping:
+ *
+ *   ORIG NEW
+ *   1 1
+ *   2 2
+ *   3 -1
+ *   4 5,6
+ *   ...
+ *
+ * - ORIG = line number in the old file
+ * - NEW  = corresponding line in the new file, or -1 if deleted;
+ *          a line split over several new lines lists all of them, comma separated
+ * - Insertions in the new file are *not* listed explicitly; they can be
+ *   inferred from gaps in the NEW column.
+ */
+public class TextMappingFormat implements MappingFormat {
+
+    @Override
+    public void write(MappingTable table, Path out) throws IOException {
+        try (BufferedWriter writer = Files.newBufferedWriter(out)) {
+            writer.write("ORIG NEW");
+            writer.newLine();
+            for (int oldLine = 1; oldLine <= table.size(); oldLine++) {
+                if (!table.has(oldLine)) continue;
+                // Only "old new" — no status label
+                writer.write(Integer.toString(oldLine));
+                writer.write(' ');
+                writeNewLines(writer, table, oldLine);
+                writer.newLine();
+            }
+        }
+    }
+
+    // "5" or, for a split group, "5,6,7" (the same list XmlMappingFormat puts in NEW)
+    static void writeNewLines(Writer writer, MappingTable table, int oldLine) throws IOException {
+        int newLine = table.getNewLine(oldLine);
+        writer.write(Integer.toString(newLine));
+        for (int next = newLine + 1; next <= table.getNewLineEnd(oldLine); next++) {
+            writer.write(',');
+            writer.write(Integer.toString(next));
+        }
+    }
+}
@@ -0,0 +1,201 @@
+package tool;
+
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * Interns tokens so every distinct token string gets one small int id.
+ *
+ * One dictionary is shared by both FileVersions of a run (the Preprocessor owns it),
+ * so equal tokens in the old and new file have equal ids and the later steps can
+ * compare int arrays instead of re-splitting strings.
+ *
+ * Tokens are looked up by char range (intern(char[], start, end)): the range is hashed
+ * in place and probed in an open-addressing table of ids, and a String is only made
+ * the first time a token is seen. So tokenizing a line allocates nothing per token
+ * occurrence, only per new distinct token.
+ *
+ * It also gives every distinct normalized line an id (internLine), so Step 2 can
+ * compare lines as ints without building their Strings. Lines are keyed by a 64-bit
+ * hash of the normalized text; a second, independent hash (String.hashCode of the
+ * same text) is kept per id, and an id that ever sees two different check values is
+ * marked ambiguous. Only for those ids do the detectors look at the text itself.
+ */
+public class TokenDictionary {
+
+    private int[] slots = new int[128];     // open addressing by token hash: id + 1, 0 = empty
+    private final List<String> tokens = new ArrayList<>();
+    private long[] hashes = new long[64]; // 64-bit hash of each token's text, for SimHash
+
+    private final Map<Long, Integer> lineIds = new HashMap<>(); // 64-bit normalized line hash -> line id
+    private int[] lineChecks = new int[64];          // check hash of the first line seen with each id
+    private boolean[] ambiguousLines = new boolean[64]; // id shared by lines with different text
+    private int lineCount;
+
+    /**
+     * Return the id of the token, adding it if we have not seen it yet.
+     */
+    public synchronized int intern(String token) {
+        char[] chars = token.toCharArray();
+        return intern(chars, 0, chars.length, token);
+    }
+
+    /**
+     * intern(new String(text, start, end - start)), without making the String unless
+     * the token is new.
+     */
+    public synchronized int intern(char[] text, int start, int end) {
+        return intern(text, start, end, null);
+    }
+
+    // token = the String of the range if the caller already has one, else null
+    private int intern(char[] text, int start, int end, String token) {
+        long hash = hash64(text, start, end);
+        int mask = slots.length - 1;
+        int slot = (int) hash & mask;
+        for (int entry; (entry = slots[slot]) != 0; slot = (slot + 1) & mask) {
+            int id = entry - 1;
+            if (hashes[id] == hash && sameText(tokens.get(id), text, start, end)) {
+                return id;
+            }
+        }
+
+        int id = tokens.size();
+        tokens.add(token != null ? token : new String(text, start, end - start));
+        if (id == hashes.length) hashes = Arrays.copyOf(hashes, id * 2);
+        hashes[id] = hash;
+        slots[slot] = id + 1;
+        if (2 * tokens.size() > slots.length) growSlots();
+        return id;
+    }
+
+    // double the table and put every id back (load stays <= 1/2)
+    private void growSlots() {
+        slots = new int[slots.length * 2];
+        int mask = slots.length - 1;
+        for (int id = 0; id < tokens.size(); id++) {
+            int slot = (int) hashes[id] & mask;
+            while (slots[slot] != 0) slot = (slot + 1) & mask;
+            slots[slot] = id + 1;
+        }
+    }
+
+    private static boolean sameText(String token, char[] text, int start, int end) {
+        if (token.length() != end - start) return false;
+        for (int i = 0; i < token.length(); i++) {
+            if (token.charAt(i) != text[start + i]) return false;
+        }
+        return true;
+    }
+
+    /**
+     * The token text for an id returned by intern.
+     */
+    public synchronized String getToken(int id) {
+        return tokens.get(id);
+    }
+
+    /**
+     * 64-bit hash of the token text. It only depends on the text,
+     * so it is the same in every dictionary.
+     */
+    public synchronized long getTokenHash(int id) {
+        return hashes[id];
+    }
+
+    /**
+     * Copy of every token hash, indexed by id, so callers can read them without locking.
+     */
+    public synchronized long[] getTokenHashes() {
+        return Arrays.copyOf(hashes, tokens.size());
+    }
+
+    /**
+     * Number of distinct tokens seen so far (ids are 0 .. size-1).
+     */
+    public synchronized int size() {
+        return tokens.size();
+    }
+
+    /**
+     * Id of a normalized line, from lineHash and lineCheck of its text. Equal text always
+     * gets an equal id; different text gets a different id unless the 64-bit hashes
+     * collide, and then the id is marked ambiguous (see isAmbiguousLine).
+     */
+    public synchronized int internLine(long hash, int check) {
+        Integer id = lineIds.get(hash);
+        if (id == null) {
+            id = lineCount++;
+            if (id == lineChecks.length) {
+                lineChecks = Arrays.copyOf(lineChecks, id * 2);
+                ambiguousLines = Arrays.copyOf(ambiguousLines, id * 2);
+            }
+            lineIds.put(hash, id);
+            lineChecks[id] = check;
+        } else if (lineChecks[id] != check) {
+            ambiguousLines[id] = true; // hash collision: two texts behind one id
+        }
+        return id;
+    }
+
+    /**
+     * True if lines with this id may have different text, so they have to be compared as text.
+     */
+    public synchronized boolean isAmbiguousLine(int lineId) {
+        return ambiguousLines[lineId];
+    }
+
+    /**
+     * Number of line ids handed out (ids are 0 .. lineCount-1).
+     */
+    public synchronized int getLineCount() {
+        return lineCount;
+    }
+
+    /**
+     * 64-bit key of a normalized line for internLine.
+     */
+    public static long lineHash(char[] text, int length) {
+        long h = 0xcbf29ce484222325L;
+        for (int i = 0; i < length; i++) {
+            h ^= text[i];
+            h *= 0x100000001b3L;
+        }
+        return mix(h);
+    }
+
+    /**
+     * Check value of a normalized line for internLine; equal to String.hashCode of the text.
+     */
+    public static int lineCheck(char[] text, int length) {
+        int h = 0;
+        for (int i = 0; i < length; i++) {
+            h = 31 * h + text[i];
+        }
+        return h;
+    }
+
+    // FNV-1a over the chars, then the MurmurHash3 finalizer so every bit depends on every char
+    private static long hash64(char[] text, int start, int end) {
+        long h = 0xcbf29ce484222325L;
+        for (int i = start; i < end; i++) {
+            h ^= text[i];
+            h *= 0x100000001b3L;
+        }
+        return mix(h);
+    }
+
+    // MurmurHash3 finalizer
+    private static long mix(long h) {
+        h ^= h >>> 33;
+        h *= 0xff51afd7ed558ccdL;
+        h ^= h >>> 33;
+        h *= 0xc4ceb9fe1a85ec53L;
+        h ^= h >>> 33;
+        return h;
+    }
+}
@@ -1,11 +1,11 @@
 package tool;
 
 
+import java.util.ArrayDeque;
 import java.util.HashMap;
-import java.util.HashSet;
+import java.util.Iterator;
 import java.util.List;
 import java.util.Map;
-import java.util.Set;
 
 /**
  * Step 2: DETECT UNCHANGED LINES
@@ -14,19 +14,27 @@ import java.util.Set;
  * old and new files.
  *
  * Logic:
- *  - For each old line:
- *      - Scan through all new lines.
- *      - If normalized text matches AND the new line has not been used yet,
- *        we treat this pair as "unchanged".
+ *  - Bucket every new line by its line id (the Preprocessor's id of the normalized
+ *    text, TokenDictionary.internLine). Each bucket is a queue of new lines in file order.
+ *  - For each old line (in file order):
+ *      - Look up the bucket for its id.
+ *      - Take the first queued new line and remove it from the queue (so it can't be
+ *        used again). Equal ids are equal text, so no String is built; only for an id
+ *        the dictionary marks ambiguous (a 64-bit hash collision) we compare the text,
+ *        normalized on the spot and not kept.
  *  - Store mapping as: oldLineNumber -> newLineNumber
  *
- *  This matches the description:
+ *  This gives the same result as the original description:
  *      - outer loop: old lines
  *      - inner loop: new lines
  *      - first available exact normalized match wins
+ *  but in linear time instead of comparing every old line to every new line.
  */
 public class UnchangedDetector { // we detect unchanged lines
 
+    private int matchedCount;   // how many old lines got an exact match in the last run
+    private int collisionCount; // how many times an ambiguous bucket held a line with a different text
+
     /**
      * We Detect unchanged lines between two file versions.
      *
@@ -36,38 +44,64 @@ public class UnchangedDetector { // we detect unchanged lines
      */
     public Map<Integer, Integer> detectUnchanged(FileVersion oldFile, FileVersion newFile) { // we basically compare lines
         Map<Integer, Integer> unchangedMapping = new HashMap<>(); // we store unchanged mapping here
+        matchedCount = 0;
+        collisionCount = 0;
 
         List<LineRecord> oldLines = oldFile.getLines(); // get old lines
         List<LineRecord> newLines = newFile.getLines();// get new lines
+        TokenDictionary dictionary = oldFile.getDictionary(); // shared with newFile, so the ids line up
 
-        // Track which new lines are already matched
-        Set<Integer> usedNewLines = new HashSet<>();
+        // Bucket new lines by line id, keeping file order inside each queue
+        Map<Integer, ArrayDeque<LineRecord>> buckets = new HashMap<>();
+        for (LineRecord newLine : newLines) {
+            buckets.computeIfAbsent(newLine.getLineId(), id -> new ArrayDeque<>())
+                    .addLast(newLine);
+        }
 
         for (LineRecord oldLine : oldLines) { // we loop through old lines to find matches
-            String oldNorm = oldLine.getNormalizedText();
-            int oldLineNum = oldLine.getLineNumber();
-
-            // Try to find a matching new line (normalized text equal, unused)
-            for (LineRecord newLine : newLines) {
-                int newLineNum = newLine.getLineNumber();
-
-                if (usedNewLines.contains(newLineNum)) {
-                    continue; // this means new line is already used
-                }
+            ArrayDeque<LineRecord> queue = buckets.get(oldLine.getLineId());
+            if (queue == null || queue.isEmpty()) {
+                continue; // no (unused) new line with this text
+            }
 
-                String newNorm = newLine.getNormalizedText(); // get normalized text of new line
+            if (!dictionary.isAmbiguousLine(oldLine.getLineId())) {
+                LineRecord newLine = queue.pollFirst(); // same id = same text
+                unchangedMapping.put(oldLine.getLineNumber(), newLine.getLineNumber());
+                matchedCount++;
+                continue;
+            }
 
-                if (oldNorm.equals(newNorm)) {  
+            // Hash collision behind this id: find the first queued new line with equal text
+            String oldNorm = oldLine.getNormalizedTextUncached();
+            Iterator<LineRecord> it = queue.iterator();
+            while (it.hasNext()) {
+                LineRecord newLine = it.next();
+                if (oldNorm.equals(newLine.getNormalizedTextUncached())) {
                     // Found an unchanged pair
-                    unchangedMapping.put(oldLineNum, newLineNum); // to store mapping
-                    usedNewLines.add(newLineNum);
+                    unchangedMapping.put(oldLine.getLineNumber(), newLine.getLineNumber()); // to store mapping
+                    it.remove(); // this new line is now used
+                    matchedCount++;
                     break; // move to next old line
                 }
+                collisionCount++; // same id, different text
             }
         }
 
         return unchangedMapping;
     }
-}
 
+    /**
+     * Number of exact matches found by the last call to detectUnchanged.
+     */
+    public int getMatchedCount() {
+        return matchedCount;
+    }
 
+    /**
+     * Number of hash collisions (same line id, different normalized text)
+     * seen by the last call to detectUnchanged.
+     */
+    public int getCollisionCount() {
+        return collisionCount;
+    }
+}
@@ -0,0 +1,55 @@
+package tool;
+
+
+import java.io.BufferedWriter;
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+
+/**
+ * The mapping in the LHDiff ground truth schema used under file_mapping/, so our output
+ * can be diffed against (or read like) the hand-made XML files:
+ *
+ *   <TEST NAME="out" FILE="">
+ *   <VERSION NUMBER="1" CHECKED="TRUE">
+ *   <LOCATION ORIG="1" NEW="1"/>
+ *   <LOCATION ORIG="3" NEW="-1"/>
+ *   <LOCATION ORIG="4" NEW="5,6"/>      (split line, as in the ground truth files)
+ *   </VERSION>
+ *   </TEST>
+ *
+ * Written line by line as we go, nothing is built in memory.
+ */
+public class XmlMappingFormat implements MappingFormat {
+
+    @Override
+    public void write(MappingTable table, Path out) throws IOException {
+        String name = out.getFileName().toString();
+        int dot = name.indexOf('.');
+        if (dot > 0) name = name.substring(0, dot);
+
+        try (BufferedWriter writer = Files.newBufferedWriter(out)) {
+            writer.write("<TEST NAME=\"" + escape(name) + "\" FILE=\"\">");
+            writer.newLine();
+            writer.write("<VERSION NUMBER=\"1\" CHECKED=\"TRUE\">");
+            writer.newLine();
+            for (int oldLine = 1; oldLine <= table.size(); oldLine++) {
+                if (!table.has(oldLine)) continue;
+                writer.write("<LOCATION ORIG=\"");
+                writer.write(Integer.toString(oldLine));
+                writer.write("\" NEW=\"");
+                TextMappingFormat.writeNewLines(writer, table, oldLine);
+                writer.write("\"/>");
+                writer.newLine();
+            }
+            writer.write("</VERSION>");
+            writer.newLine();
+            writer.write("</TEST>");
+            writer.newLine();
+        }
+    }
+
+    private static String escape(String text) {
+        return text.replace("&", "&amp;").replace("\"", "&quot;").replace("<", "&lt;").replace(">", "&gt;");
+    }
+}
@@ -0,0 +1,82 @@
+package tool;
+
+
+import jdk.incubator.vector.DoubleVector;
+import jdk.incubator.vector.LongVector;
+import jdk.incubator.vector.VectorMask;
+import jdk.incubator.vector.VectorOperators;
+import jdk.incubator.vector.VectorSpecies;
+
+/**
+ * BlockKernels on the Vector API (jdk.incubator.vector, JDK 21+).
+ *
+ * Only compiled and loaded with --add-modules jdk.incubator.vector, see BlockKernels
+ * for the commands; BlockKernels.select() creates it by name, so nothing else refers
+ * to this class.
+ *
+ *  - similarityBlock: gathers LANES candidate fingerprints at once (the line numbers are
+ *    the gather indices), XOR with the query, lane popcount, 1 - d/32 clipped at 0
+ *  - jaccardBlock: per candidate row, AND / AND-NOT + lane popcount over LANES words
+ *    at a time (masked at the end of the shorter row), then one add across lanes
+ *
+ * Results are exactly the scalar ones: the popcounts are integers and d/32 is exact.
+ */
+final class VectorKernels implements BlockKernels {
+
+    private static final VectorSpecies<Long> LONGS = LongVector.SPECIES_PREFERRED;
+    private static final int LANES = LONGS.length();
+
+    VectorKernels() {
+        if (LANES < 2) {
+            throw new UnsupportedOperationException("no vector registers"); // select() falls back to SCALAR
+        }
+    }
+
+    @Override
+    public void similarityBlock(long query, long[] fingerprints, int[] lines, int count, double[] out) {
+        LongVector q = LongVector.broadcast(LONGS, query);
+        int k = 0;
+        for (; k <= count - LANES; k += LANES) {
+            // fingerprints[lines[k + i] - 1]: offset -1 because the line numbers are 1-based
+            LongVector candidates = LongVector.fromArray(LONGS, fingerprints, -1, lines, k);
+            LongVector distance = candidates.lanewise(VectorOperators.XOR, q).lanewise(VectorOperators.BIT_COUNT);
+            // 32+ differing bits gives <= 0 here, so max(0) is SimHash's "0.0 from 32 on"
+            ((DoubleVector) distance.convert(VectorOperators.L2D, 0))
+                    .div(-32.0).add(1.0).max(0.0)
+                    .intoArray(out, k);
+        }
+        for (; k < count; k++) { // tail
+            int distance = Long.bitCount(query ^ fingerprints[lines[k] - 1]);
+            out[k] = distance >= 32 ? 0.0 : 1.0 - distance / 32.0;
+        }
+    }
+
+    @Override
+    public void jaccardBlock(long[] a, long[][] rows, int[] lines, int count, double[] out) {
+        int ownBits = 0;
+        for (long word : a) ownBits += Long.bitCount(word);
+        for (int k = 0; k < count; k++) {
+            long[] b = rows[lines[k] - 1];
+            int shared = Math.min(a.length, b.length);
+            LongVector common = LongVector.zero(LONGS);
+            LongVector onlyB = LongVector.zero(LONGS); // bits of b outside a, so union = |a| + onlyB
+            for (int w = 0; w < shared; w += LANES) {
+                VectorMask<Long> inRange = LONGS.indexInRange(w, shared); // masked lanes load 0
+                LongVector av = LongVector.fromArray(LONGS, a, w, inRange);
+                LongVector bv = LongVector.fromArray(LONGS, b, w, inRange);
+                common = common.add(av.and(bv).lanewise(VectorOperators.BIT_COUNT));
+                onlyB = onlyB.add(bv.lanewise(VectorOperators.AND_NOT, av).lanewise(VectorOperators.BIT_COUNT));
+            }
+            int commonBits = (int) common.reduceLanes(VectorOperators.ADD);
+            int onlyBBits = (int) onlyB.reduceLanes(VectorOperators.ADD);
+            for (int w = shared; w < b.length; w++) onlyBBits += Long.bitCount(b[w]);
+            int union = ownBits + onlyBBits;
+            out[k] = union == 0 ? 1.0 : (double) commonBits / union;
+        }
+    }
+
+    @Override
+    public String name() {
+        return "vector (" + LONGS.vectorBitSize() + "-bit)";
+    }
+}